@@ -0,0 +1,63 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+/* A minimal harness for the benchmarks in this directory.  Each
+case is run several times, and the best and the worst times are
+printed, as the spread tells more than a mean on a busy machine. */
+namespace bench
+{
+    template <typename Fn>
+    double TimeMs(Fn&& fn)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - begin).count();
+    }
+
+    inline void Print(const std::string& name, const std::vector<double>& times)
+    {
+        auto [best, worst] = std::minmax_element(times.begin(), times.end());
+        std::fprintf(stderr, "%-48s %10.1f ms %10.1f ms\n",
+            name.c_str(), *best, *worst);
+    }
+
+    // Runs a case n_runs times and prints its best and worst times
+    template <typename Fn>
+    void Run(const std::string& name, size_t n_runs, Fn&& fn)
+    {
+        std::vector<double> times;
+        for (size_t n = 0; n < n_runs; ++n) times.push_back(TimeMs(fn));
+        Print(name, times);
+    }
+
+    inline void PrintHeader()
+    {
+        std::fprintf(stderr, "%-48s %13s %13s\n", "case", "best", "worst");
+    }
+
+    // Progress output of the cacher is dropped while it lives
+    class QuietCout
+    {
+    private:
+        struct NullBuffer : std::streambuf
+        {
+            int overflow(int c) override { return c; }
+        };
+
+        NullBuffer null_{};
+        std::streambuf* old_ = nullptr;
+
+    public:
+        QuietCout() : old_{std::cout.rdbuf(&null_)} {}
+        QuietCout(const QuietCout&) = delete;
+        QuietCout& operator=(const QuietCout&) = delete;
+        ~QuietCout() { std::cout.rdbuf(old_); }
+    };
+}
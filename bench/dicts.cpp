@@ -0,0 +1,199 @@
+#include "bench.h"
+#include "flat_hash_map.h"
+#include "name_hash.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/* The cacher's dictionaries against the node-based maps they
+replaced: asset names, looked up in another case as inputs are,
+and chunks of assets, which used to be a map of maps */
+namespace
+{
+    struct Hasher
+    {
+        size_t operator()(std::string_view sv) const { return NameHash(sv); }
+    };
+
+    struct Equals
+    {
+        bool operator()(std::string_view sv1, std::string_view sv2) const
+        {
+            return NameEquals(sv1, sv2);
+        }
+    };
+
+    // As AssetCacher::ChunkKey and its hasher
+    struct ChunkKey
+    {
+        size_t asset = 0;
+        std::string_view name{};
+    };
+
+    struct ChunkKeyHasher
+    {
+        size_t operator()(const ChunkKey& key) const
+        {
+            return NameHash(key.name) ^ (key.asset * 0x9e'37'79'b9);
+        }
+    };
+
+    struct ChunkKeyEquals
+    {
+        bool operator()(const ChunkKey& key1, const ChunkKey& key2) const
+        {
+            return key1.asset == key2.asset && NameEquals(key1.name, key2.name);
+        }
+    };
+
+    using UnorderedDict = std::unordered_map<std::string_view, size_t, Hasher, Equals>;
+    using FlatDict = FlatHashMap<std::string_view, size_t, Hasher, Equals>;
+    using FlatChunksDict = FlatHashMap<ChunkKey, size_t, ChunkKeyHasher, ChunkKeyEquals>;
+}
+
+// Usage: BenchDicts [number of assets] [number of runs]
+int main(int argc, char** argv)
+{
+    size_t n_assets = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    size_t n_runs = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5;
+    constexpr size_t n_chunks = 4; // per asset
+
+    std::mt19937 rng(1);
+    std::vector<std::string> names(n_assets);
+    std::vector<std::string> chunk_names(n_assets * n_chunks);
+    std::vector<std::string> probes(n_assets);
+    std::vector<size_t> probe_hashes(n_assets);
+
+    for (size_t i = 0; i < n_assets; ++i)
+    {
+        names[i] = "ASSET_" + std::to_string(rng()) + "_" + std::to_string(i);
+        for (size_t j = 0; j < n_chunks; ++j)
+        {
+            chunk_names[i * n_chunks + j] = names[i] + ".CHUNK" + std::to_string(j);
+        }
+    }
+
+    // Inputs name assets in lower case
+    for (size_t i = 0; i < n_assets; ++i)
+    {
+        probes[i] = names[rng() % n_assets];
+        for (char& c : probes[i]) c = (char)std::tolower((unsigned char)c);
+        probe_hashes[i] = NameHash(probes[i]);
+    }
+
+    size_t sink = 0;
+    bench::PrintHeader();
+
+    bench::Run("assets: insert, unordered_map", n_runs, [&]
+        {
+            UnorderedDict dict;
+            for (size_t i = 0; i < n_assets; ++i) dict[names[i]] = i;
+            sink += dict.size();
+        });
+
+    bench::Run("assets: insert, FlatHashMap", n_runs, [&]
+        {
+            FlatDict dict;
+            for (size_t i = 0; i < n_assets; ++i) dict[names[i]] = i;
+            sink += dict.size();
+        });
+
+    {
+        UnorderedDict unordered;
+        FlatDict flat;
+        for (size_t i = 0; i < n_assets; ++i) unordered[names[i]] = flat[names[i]] = i;
+
+        bench::Run("assets: look up, unordered_map", n_runs, [&]
+            {
+                for (const std::string& probe : probes) sink += unordered.find(probe)->second;
+            });
+
+        bench::Run("assets: look up, FlatHashMap", n_runs, [&]
+            {
+                for (const std::string& probe : probes) sink += flat.find(probe)->second;
+            });
+
+        bench::Run("assets: look up hashed, FlatHashMap", n_runs, [&]
+            {
+                for (size_t i = 0; i < n_assets; ++i)
+                {
+                    sink += flat.find(probes[i], probe_hashes[i])->second;
+                }
+            });
+    }
+
+    using NestedDict = std::unordered_map<size_t, UnorderedDict>;
+
+    auto fill_nested = [&](NestedDict& dict)
+    {
+        for (size_t i = 0; i < n_assets; ++i)
+        {
+            UnorderedDict& chunks = dict[i];
+            for (size_t j = 0; j < n_chunks; ++j)
+            {
+                chunks[chunk_names[i * n_chunks + j]] = j;
+            }
+        }
+    };
+
+    auto fill_flat = [&](FlatChunksDict& dict)
+    {
+        for (size_t i = 0; i < n_assets; ++i)
+        {
+            for (size_t j = 0; j < n_chunks; ++j)
+            {
+                dict[ChunkKey{ i, chunk_names[i * n_chunks + j] }] = j;
+            }
+        }
+    };
+
+    bench::Run("chunks: insert, map of unordered_maps", n_runs, [&]
+        {
+            NestedDict dict;
+            fill_nested(dict);
+            sink += dict.size();
+        });
+
+    bench::Run("chunks: insert, FlatHashMap", n_runs, [&]
+        {
+            FlatChunksDict dict;
+            fill_flat(dict);
+            sink += dict.size();
+        });
+
+    {
+        NestedDict nested;
+        FlatChunksDict flat;
+        fill_nested(nested);
+        fill_flat(flat);
+
+        // Input records refer to chunks of assets in any order
+        std::vector<size_t> chunk_probes(n_assets * n_chunks);
+        for (size_t& probe : chunk_probes) probe = rng() % chunk_probes.size();
+
+        bench::Run("chunks: look up, map of unordered_maps", n_runs, [&]
+            {
+                for (size_t probe : chunk_probes)
+                {
+                    sink += nested.find(probe / n_chunks)->second.find(
+                        chunk_names[probe])->second;
+                }
+            });
+
+        bench::Run("chunks: look up, FlatHashMap", n_runs, [&]
+            {
+                for (size_t probe : chunk_probes)
+                {
+                    sink += flat.find(ChunkKey{ probe / n_chunks, 
+                        chunk_names[probe] })->second;
+                }
+            });
+    }
+
+    return sink == 0;
+}
@@ -0,0 +1,164 @@
+#include "bench.h"
+#include "asset_cacher.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/* Writing of asset.dat from an index imported from a large one, as
+incremental runs over big caches do, by the number of threads */
+namespace
+{
+    void WriteShortString(std::string& out, const std::string& string)
+    {
+        out += (char)string.size();
+        out += string;
+    }
+
+    template <typename T>
+    void Write(std::string& out, T t)
+    {
+        out.append((const char*)&t, sizeof(t));
+    }
+
+    // Assets of four meshes each, the first of which has three inputs
+    void WriteDat(const std::filesystem::path& path, size_t n_assets)
+    {
+        std::mt19937 rng(1);
+        std::string assets;
+        std::string inputs;
+
+        for (size_t i = 0; i < n_assets; ++i)
+        {
+            std::string name = "ASSET_" + std::to_string(i) + "_" + std::to_string(rng());
+
+            WriteShortString(assets, name);
+            Write<uint64_t>(assets, 132'000'000'000'000'000 + i);
+            Write<uint16_t>(assets, 4);
+            for (uint32_t j = 0; j < 4; ++j)
+            {
+                WriteShortString(assets, name + ".CHUNK" + std::to_string(j));
+                Write<uint32_t>(assets, 0x4d'45'53'48 /*MESH*/);
+                Write<uint32_t>(assets, j * 100);
+                Write<uint32_t>(assets, 100);
+            }
+
+            WriteShortString(inputs, name);
+            WriteShortString(inputs, name + ".CHUNK0");
+            Write<uint16_t>(inputs, 3);
+            for (int j = 0; j < 3; ++j)
+            {
+                WriteShortString(inputs, "TEX_" + std::to_string(rng() % n_assets) + ".TGA");
+            }
+        }
+
+        std::string header("ALAE\2\1\0\0", 8);
+        Write<uint32_t>(header, (uint32_t)n_assets);
+        Write<uint32_t>(header, (uint32_t)n_assets);
+
+        std::ofstream ofs(path, std::ios::binary);
+        ofs.write(header.data(), header.size());
+        ofs.write(assets.data(), assets.size());
+        ofs.write(inputs.data(), inputs.size());
+    }
+
+    /* Progress output is dropped, except that the time is taken 
+    when the snapshot's export starts, as asset.dat is written by 
+    then, and the snapshot is timed apart */
+    class SnapshotMark : public std::streambuf
+    {
+    private:
+        constexpr static std::string_view mark = "**Exporting the index snapshot";
+
+        std::string line_{};
+        std::streambuf* old_ = nullptr;
+
+    public:
+        std::chrono::steady_clock::time_point time{};
+
+        SnapshotMark() : old_{std::cout.rdbuf(this)} {}
+        SnapshotMark(const SnapshotMark&) = delete;
+        SnapshotMark& operator=(const SnapshotMark&) = delete;
+        ~SnapshotMark() { std::cout.rdbuf(old_); }
+
+    protected:
+        int overflow(int c) override
+        {
+            if (c != '\n')
+            {
+                if (line_.size() < mark.size()) line_ += (char)c;
+                return c;
+            }
+
+            if (line_ == mark) time = std::chrono::steady_clock::now();
+            line_.clear();
+            return c;
+        }
+    };
+}
+
+// Usage: BenchExport [directory] [number of assets] [number of runs] [max threads]
+int main(int argc, char** argv)
+{
+    std::string root = argc > 1 ? argv[1] : "bench_export";
+    size_t n_assets = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1'000'000;
+    size_t n_runs = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 5;
+    unsigned int max_threads = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 
+        std::thread::hardware_concurrency();
+
+    if (!root.ends_with('/') && !root.ends_with('\\')) root += '/';
+
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    WriteDat(root + "asset.dat", n_assets);
+
+    // Thread counts double up to what the hardware supports
+    std::vector<unsigned int> thread_counts{ 1 };
+    max_threads = std::max(1u, max_threads);
+    while (thread_counts.back() * 2 <= max_threads)
+    {
+        thread_counts.push_back(thread_counts.back() * 2);
+    }
+    if (thread_counts.back() != max_threads) thread_counts.push_back(max_threads);
+
+    bench::PrintHeader();
+    for (unsigned int n_threads : thread_counts)
+    {
+        std::vector<double> dat_times;
+        std::vector<double> snapshot_times;
+        for (size_t n = 0; n < n_runs; ++n)
+        {
+            SnapshotMark snapshot_mark;
+
+            // The snapshot would be imported instead of the .dat file
+            std::filesystem::remove(root + "asset.dat.snap");
+
+            AssetCacher cacher(root);
+            cacher.SetThreads(n_threads);
+            cacher.ImportExistData();
+
+            auto begin = std::chrono::steady_clock::now();
+            cacher.ExportData();
+            auto end = std::chrono::steady_clock::now();
+
+            dat_times.push_back(std::chrono::duration<double, std::milli>(
+                snapshot_mark.time - begin).count());
+            snapshot_times.push_back(std::chrono::duration<double, std::milli>(
+                end - snapshot_mark.time).count());
+        }
+
+        std::string name = std::to_string(n_assets) + " assets, " + 
+            std::to_string(n_threads) + " thread(s), ";
+        bench::Print(name + "asset.dat", dat_times);
+        bench::Print(name + "snapshot", snapshot_times);
+    }
+
+    std::filesystem::remove_all(root);
+}
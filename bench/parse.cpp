@@ -0,0 +1,93 @@
+#include "bench.h"
+#include "asset_cacher.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+/* Parsing of models full of chunks which are not cached: lights
+and dazzles, which are read for names and inputs, and Lightscape
+chunks, which have no reader and are stepped over */
+namespace
+{
+    void WriteChunk(std::string& out, ChunkType chunk_type,
+        const std::string& data, bool has_subchunks = false)
+    {
+        uint32_t type = (uint32_t)chunk_type;
+        uint32_t size = (uint32_t)data.size() | (has_subchunks ? 0x80000000 : 0);
+        out.append((const char*)&type, sizeof(type));
+        out.append((const char*)&size, sizeof(size));
+        out += data;
+    }
+
+    std::string Chunk(ChunkType type, const std::string& data,
+        bool has_subchunks = false)
+    {
+        std::string out;
+        WriteChunk(out, type, data, has_subchunks);
+        return out;
+    }
+
+    // A box, which is cached, followed by groups of uncached chunks
+    void WriteModel(const std::filesystem::path& path, size_t i,
+        size_t n_groups)
+    {
+        std::string box_data(8 + 32 + 40, '\0');
+        box_data[0] = 1; // the version
+        std::string box_name = "B" + std::to_string(i) + ".BOX";
+        box_data.replace(8, box_name.size(), box_name);
+
+        std::string light = Chunk(ChunkType::W3D_CHUNK_LIGHT,
+            Chunk(ChunkType::W3D_CHUNK_LIGHT_INFO, std::string(48, '\0')), true);
+        std::string dazzle = Chunk(ChunkType::W3D_CHUNK_DAZZLE,
+            Chunk(ChunkType::W3D_CHUNK_DAZZLE_NAME, std::string("DAZ.NAME", 9)) +
+            Chunk(ChunkType::W3D_CHUNK_DAZZLE_TYPENAME, std::string("DEFAULT", 8)),
+            true);
+        std::string lightscape = Chunk(ChunkType::W3D_CHUNK_LIGHTSCAPE,
+            Chunk(ChunkType::W3D_CHUNK_LIGHTSCAPE_LIGHT, std::string(48, '\0')), true);
+        std::string group = light + dazzle + lightscape;
+
+        std::string model = Chunk(ChunkType::W3D_CHUNK_BOX, box_data);
+        model.reserve(model.size() + n_groups * group.size());
+        for (size_t n = 0; n < n_groups; ++n) model += group;
+
+        std::ofstream(path, std::ios::binary).write(model.data(), model.size());
+    }
+}
+
+// Usage: BenchParse [directory] [number of models] [groups per model] [number of runs]
+int main(int argc, char** argv)
+{
+    std::string root = argc > 1 ? argv[1] : "bench_parse";
+    size_t n_models = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200;
+    size_t n_groups = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 4000;
+    size_t n_runs = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 5;
+
+    if (!root.ends_with('/') && !root.ends_with('\\')) root += '/';
+
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    for (size_t i = 0; i < n_models; ++i)
+    {
+        WriteModel(root + "m" + std::to_string(i) + ".w3d", i, n_groups);
+    }
+
+    bench::PrintHeader();
+    for (unsigned int n_threads : { 1u, 0u })
+    {
+        std::string name = std::to_string(n_models) + " models, " +
+            (n_threads ? std::to_string(n_threads) : "all") + " thread(s)";
+
+        bench::Run(name, n_runs, [&]
+            {
+                bench::QuietCout quiet;
+                AssetCacher cacher(root);
+                cacher.SetThreads(n_threads);
+                cacher.ImportNewData();
+            });
+    }
+
+    std::filesystem::remove_all(root);
+}
@@ -11,204 +11,1606 @@ const std::vector<std::string_view> AssetCacher::formats =
     ".w3d"
 };
 
-bool AssetCacher::IsValidFile(const File& file)
+bool AssetCacher::IsValidFile(const File& file, 
+    FileRecord::Type& type)
 {
     using namespace std::string_view_literals;
 
     if (!file.is_regular_file()) return false;
 
     std::string ext = file.path().extension().string();
+    for (char& c : ext) c = std::tolower(c);
 
     std::vector<std::string_view>::const_iterator pos;
     pos = BinarySearch(formats.begin(), formats.end(), ext);
-    return (pos != formats.end());
+    if (pos == formats.end()) return false;
+
+    type = (*pos == ".w3d"sv) ? FileRecord::Type::Model : 
+        FileRecord::Type::Texture;
+    return true;
+}
+
+uint64_t AssetCacher::ReadDatHeader(BinaryReader& reader)
+{
+    using namespace std::string_view_literals;
+
+    if (reader.Size() < 0x10) return 0;
+
+    std::string_view signature(reader.Take(4), 4);
+    if (signature != "ALAE"sv) return 0;
+
+    std::string_view version(reader.Take(4), 4);
+    if (version != "\2\1\0\0"sv) return 0;
+
+    return reader.Read<uint64_t>();
+}
+
+uint64_t AssetCacher::ReadIdxHeader(BinaryReader& reader)
+{
+    using namespace std::string_view_literals;
+
+    if (reader.Size() < 0x14) return 0;
+
+    std::string_view signature(reader.Take(4), 4);
+    if (signature != "ACIX"sv) return 0;
+
+    std::string_view version(reader.Take(4), 4);
+    if (version != "\1\0\0\0"sv) return 0;
+
+    // The size of the .dat file the hashes belong to
+    return reader.Read<uint64_t>();
+}
+
+void AssetCacher::ScanFiles()
+{
+    using namespace std::filesystem;
+
+    /* The only pass over the directory tree: everything 
+    needed later on is recorded in the manifest. */
+    for (const directory_entry& file :
+        recursive_directory_iterator(root_path_))
+    {
+        FileRecord record;
+        if (!IsValidFile(file, record.type)) continue;
+
+        try
+        {
+            record.size = file.file_size();
+            record.time = Asset::ConvertFileTime(file.last_write_time());
+        }
+        catch (const filesystem_error& e)
+        {
+            std::cerr << e.what() << '\n';
+            continue;
+        }
+
+        record.path = file.path().string();
+        for (char& c : record.path) c = std::tolower(c);
+
+        manifest_.emplace_back(std::move(record));
+    }
+
+    n_assets_ += manifest_.size();
+}
+
+bool AssetCacher::IsUpToDate(const FileRecord& record) const
+{
+    if (assets_dict_.empty()) return false;
+
+    std::string_view path = record.path;
+    std::string name = Asset::MakeName(augmented::ifstream::Stem(path), 
+        augmented::ifstream::Extension(path));
+
+    /* The file's asset would not replace a record 
+    which is at least as new, so the file need not 
+    be opened at all. */
+    AssetsDict::const_iterator pos = assets_dict_.find(name);
+    return pos != assets_dict_.end() && 
+        record.time <= assets_[pos->second].time;
+}
+
+std::string_view AssetCacher::SourcePath(const FileRecord& record) const
+{
+    // Paths are kept relative to the root, which may move
+    return std::string_view(record.path).substr(root_path_.size());
+}
+
+const AssetCacher::AssetRecord* 
+AssetCacher::FindSource(const FileRecord& record) const
+{
+    if (assets_dict_.empty()) return nullptr;
+
+    std::string_view path = record.path;
+    std::string name = Asset::MakeName(augmented::ifstream::Stem(path), 
+        augmented::ifstream::Extension(path));
+
+    AssetsDict::const_iterator pos = assets_dict_.find(name);
+    if (pos == assets_dict_.end()) return nullptr;
+
+    const AssetRecord& asset = assets_[pos->second];
+    if (asset.source_id == AssetRecord::no_source || 
+        Asset::symbols.Name(asset.source_id) != SourcePath(record))
+    {
+        return nullptr;
+    }
+
+    return &asset;
+}
+
+void AssetCacher::MapFile(const FileRecord& record, 
+    ParsedFile& parsed)
+{
+    /* A file which cannot be mapped is skipped by the parser. 
+    Only models are read ahead: textures are never read, unless 
+    they are hashed. */
+    if (parsed.map.Open(record.path))
+    {
+        if (record.type == FileRecord::Type::Model)
+        {
+            parsed.map.WillNeed(model_read_ahead);
+        }
+
+        /* Hashing is the read itself: the pages it brings in are
+        the ones the parser goes through next */
+        if (parsed.is_hashed)
+        {
+            parsed.content_hash = ContentHash(parsed.map.Data(), 
+                parsed.map.Size());
+            parsed.is_unchanged = parsed.last_hash == parsed.content_hash;
+        }
+    }
+
+    parsed.mapped.test_and_set(std::memory_order_release);
+    parsed.mapped.notify_one();
+}
+
+uint64_t AssetCacher::ParseCacheKey(const ParsedFile& parsed)
+{
+    // Records of other versions of the parser are never looked up
+    return parsed.content_hash ^ (parse_cache_version * 0x9e'37'79'b9'7f'4a'7c'15);
+}
+
+void AssetCacher::RestoreFile(const FileRecord& record, 
+    ParsedFile& parsed, 
+    augmented::ifstream& ifs, 
+    ParseCacheBackend& cache)
+{
+    std::optional<std::string> entry = cache.Load(ParseCacheKey(parsed));
+    if (!entry) return;
+
+    /* Records start with the size of the file, so that files 
+    which only collide by their hashes are still told apart */
+    BinaryReader reader(entry->data(), entry->size());
+
+    try
+    {
+        if (reader.Read<uint64_t>() != ifs.Reader().Size()) return;
+
+        parsed.asset.emplace(Asset::MakeName(ifs.FileStem(), ifs.FileExt()), 
+            record.size, record.time, reader);
+        parsed.is_restored = true;
+    }
+    catch (const std::out_of_range&)
+    {
+        // A damaged record is overlooked, and the file is parsed
+        parsed.asset.reset();
+    }
+}
+
+void AssetCacher::StoreFile(ParsedFile& parsed, 
+    augmented::ifstream& ifs, 
+    ParseCacheBackend& cache)
+{
+    BinaryWriter writer;
+    writer.Write<uint64_t>(ifs.Reader().Size());
+    parsed.asset->WriteParsed(writer);
+
+    cache.Store(ParseCacheKey(parsed), 
+        std::string_view(writer.Data(), writer.Size()));
+}
+
+void AssetCacher::ParseFile(const FileRecord& record, 
+    ParsedFile& parsed, 
+    ParseCacheBackend* cache)
+{
+    parsed.mapped.wait(false, std::memory_order_acquire);
+
+    if (parsed.is_unchanged)
+    {
+        parsed.map.Close();
+        parsed.ready.test_and_set(std::memory_order_release);
+        parsed.ready.notify_one();
+        return;
+    }
+
+    try
+    {
+        augmented::ifstream ifs;
+        ifs.Map(record.path, std::move(parsed.map));
+        
+        if (ifs.IsOpen())
+        {
+            if (cache) RestoreFile(record, parsed, ifs, *cache);
+            
+            if (!parsed.asset)
+            {
+                parsed.asset.emplace(ifs, record.size, record.time);
+                if (cache) StoreFile(parsed, ifs, *cache);
+            }
+        }
+    }
+    catch (...)
+    {
+        // Errors are reported when the file is merged
+        parsed.error = std::current_exception();
+    }
+
+    parsed.ready.test_and_set(std::memory_order_release);
+    parsed.ready.notify_one();
+}
+
+void AssetCacher::SkipDatChunks(BinaryReader& reader)
+{
+    uint16_t n_chunks = reader.Read<uint16_t>();
+    for (uint16_t j = 0; j < n_chunks; ++j)
+    {
+        reader.ReadShortString();
+        reader.Take(0x0c); // tag, offset and size
+    }
+}
+
+/* Steps over the chunk records of an asset, telling whether 
+each of them would be written back byte for byte once decoded */
+bool AssetCacher::SkipCanonicalDatChunks(BinaryReader& reader)
+{
+    bool is_canonical = true;
+
+    uint16_t n_chunks = reader.Read<uint16_t>();
+    for (uint16_t j = 0; j < n_chunks; ++j)
+    {
+        reader.ReadShortString();
+
+        // Tags with a stray byte are written back without it
+        is_canonical &= Asset::Chunk::IsCanonicalTag(reader.Read<uint32_t>());
+        reader.Take(0x08); // offset and size
+    }
+    return is_canonical;
+}
+
+/* Moves past the chunk record an input record refers to, which 
+is found only if it follows the chunks of the previous input 
+records, as records are written back in the order of chunks.  
+Names spelled otherwise than the chunk's are written back as 
+the chunk's, so that such records are not copied either. */
+bool AssetCacher::SkipToDatChunk(DatRecord& dat, std::string_view chunk_name)
+{
+    BinaryReader reader(dat.data, dat.size);
+    reader.Seek(dat.next_chunk);
+
+    while (!reader.AtEnd())
+    {
+        std::string_view name = reader.ReadShortString();
+        reader.Take(0x0c); // tag, offset and size
+
+        if (NameEquals(name, chunk_name))
+        {
+            dat.next_chunk = (uint32_t)reader.Tell();
+            return name == chunk_name;
+        }
+    }
+    return false;
+}
+
+void AssetCacher::SkipDatAsset(BinaryReader& reader)
+{
+    reader.ReadShortString();
+    reader.Take(0x08); // the time
+    SkipDatChunks(reader);
+}
+
+void AssetCacher::SkipDatInputs(BinaryReader& reader)
+{
+    reader.ReadShortString(); // the asset's name
+    reader.ReadShortString(); // the chunk's name
+
+    uint16_t n_chunk_inputs = reader.Read<uint16_t>();
+    for (uint16_t j = 0; j < n_chunk_inputs; ++j) reader.ReadShortString();
+}
+
+void AssetCacher::DecodeDatAsset(BinaryReader& reader, DatBlock& block)
+{
+    std::string_view name = reader.ReadShortString();
+
+    AssetRecord& record = block.assets.emplace_back();
+    record.name_id = Asset::symbols.Intern(name);
+    record.name_hash = NameHash(name);
+    record.time = reader.Read<uint64_t>();
+
+    uint16_t n_chunks = reader.Read<uint16_t>();
+    for (uint16_t j = 0; j < n_chunks; ++j)
+    {
+        std::string_view chunk_name = reader.ReadShortString();
+        ChunkType type = Asset::Chunk::ReadTypeDat(reader);
+        uint32_t offset = reader.Read<uint32_t>();
+        uint32_t size = reader.Read<uint32_t>();
+
+        // Chunks without a place in .dat files are not cached
+        if (!Asset::Chunk::IsCached(type)) continue;
+
+        block.chunks.push_back({ type, offset, size, 
+            Asset::symbols.Intern(chunk_name), NameHash(chunk_name) });
+        ++record.n_chunks;
+    }
+}
+
+void AssetCacher::DecodeDatInputs(BinaryReader& reader, DatBlock& block)
+{
+    DatInputs& record = block.input_records.emplace_back();
+    record.asset = reader.ReadShortString();
+    record.asset_hash = NameHash(record.asset);
+    record.chunk = reader.ReadShortString();
+    record.chunk_hash = NameHash(record.chunk);
+
+    record.n_inputs = reader.Read<uint16_t>();
+    for (uint32_t j = 0; j < record.n_inputs; ++j)
+    {
+        block.inputs.push_back(
+            Asset::symbols.Intern(reader.ReadShortString()));
+    }
+}
+
+template <typename Skip, typename Decode, typename Merge>
+void AssetCacher::DecodeDatBlocks(BinaryReader& reader, size_t n_records, 
+    Skip&& skip, Decode&& decode, Merge&& merge)
+{
+    if (!n_records) return;
+
+    // Several blocks per thread even out records of different sizes
+    size_t n_blocks = std::min<size_t>(n_records, 4 * n_threads_);
+    size_t block_size = (n_records + n_blocks - 1) / n_blocks;
+    n_blocks = (n_records + block_size - 1) / block_size;
+
+    /* The boundary scan only reads lengths and counts, so that 
+    blocks of records can then be decoded apart from each other */
+    std::vector<DatBlock> blocks(n_blocks);
+    for (size_t n = 0; n < n_records; ++n)
+    {
+        DatBlock& block = blocks[n / block_size];
+        if (!block.n_records) block.begin = reader.Tell();
+
+        skip(reader);
+        ++block.n_records;
+    }
+
+    std::atomic<size_t> next_block = 0;
+    size_t n_workers = std::min<size_t>(n_threads_, n_blocks);
+
+    std::vector<std::jthread> workers;
+    workers.reserve(n_workers);
+
+    for (size_t i = 0; i < n_workers; ++i)
+    {
+        workers.emplace_back([&reader, &blocks, &next_block, 
+            &decode](std::stop_token stop)
+            {
+                for (size_t b = next_block++; 
+                    b < blocks.size() && !stop.stop_requested(); 
+                    b = next_block++)
+                {
+                    DatBlock& block = blocks[b];
+
+                    try
+                    {
+                        BinaryReader block_reader(reader.Data(), reader.Size());
+                        block_reader.Seek(block.begin);
+
+                        for (size_t n = 0; n < block.n_records; ++n)
+                        {
+                            decode(block_reader, block);
+                        }
+                    }
+                    catch (...)
+                    {
+                        // Errors are reported when the block is merged
+                        block.error = std::current_exception();
+                    }
+
+                    block.ready.test_and_set(std::memory_order_release);
+                    block.ready.notify_one();
+                }
+            });
+    }
+
+    /* Blocks are merged on this thread strictly in the order of 
+    the file, so that the index does not depend on the number of 
+    threads */
+    for (DatBlock& block : blocks)
+    {
+        block.ready.wait(false, std::memory_order_acquire);
+        if (block.error) std::rethrow_exception(block.error);
+
+        merge(block);
+    }
+}
+
+void AssetCacher::MergeDatChunks(size_t i, const DatChunk* chunks, 
+    uint32_t n_chunks)
+{
+    AssetRecord& record = assets_[i];
+    record.first_chunk = (uint32_t)chunks_.Size();
+    record.n_chunks = n_chunks;
+
+    for (uint32_t j = 0; j < n_chunks; ++j)
+    {
+        const DatChunk& chunk = chunks[j];
+        uint32_t c = chunks_.Append(chunk.type, chunk.offset, chunk.size, 
+            chunk.name_id);
+
+        chunks_dict_.emplace({ i, Asset::symbols.Name(chunk.name_id) }, 
+            ChunkKeyHasher::Combine(i, chunk.name_hash)) = c;
+        SetChunkName(chunk.name_id, true);
+    }
+}
+
+void AssetCacher::MergeDatAssets(const DatBlock& block)
+{
+    const DatChunk* chunks = block.chunks.data();
+
+    for (const AssetRecord& decoded : block.assets)
+    {
+        size_t i = assets_.size();
+        assets_.push_back(decoded);
+        assets_dict_.emplace(Asset::symbols.Name(decoded.name_id), 
+            decoded.name_hash) = i;
+
+        MergeDatChunks(i, chunks, decoded.n_chunks);
+        chunks += decoded.n_chunks;
+    }
+}
+
+void AssetCacher::MergeDatInputs(const DatBlock& block)
+{
+    const uint32_t* inputs = block.inputs.data();
+
+    // Names were hashed as the records were decoded
+    for (const DatInputs& record : block.input_records)
+    {
+        size_t asset_index = assets_dict_.at(record.asset, record.asset_hash);
+        uint32_t chunk = chunks_dict_.at(ChunkKey{ asset_index, record.chunk }, 
+            ChunkKeyHasher::Combine(asset_index, record.chunk_hash));
+        chunks_.ClearInputs(chunk);
+
+        for (uint32_t j = 0; j < record.n_inputs; ++j)
+        {
+            chunks_.AddInput(chunk, *inputs++);
+        }
+    }
+}
+
+void AssetCacher::IndexDatAsset(BinaryReader& reader)
+{
+    size_t begin = reader.Tell();
+    std::string_view name = reader.ReadShortString();
+
+    size_t i = assets_.size();
+    AssetRecord& record = assets_.emplace_back();
+    record.name_id = Asset::symbols.Intern(name);
+    record.name_hash = NameHash(name);
+    record.time = reader.Read<uint64_t>();
+    record.first_chunk = (uint32_t)chunks_.Size();
+
+    assets_dict_.emplace(Asset::symbols.Name(record.name_id), 
+        record.name_hash) = i;
+
+    // Chunk records are only stepped over
+    size_t chunks_begin = reader.Tell() + sizeof(uint16_t);
+    if (SkipCanonicalDatChunks(reader))
+    {
+        record.dat_record = (uint32_t)dat_records_.size();
+        DatRecord& dat = dat_records_.emplace_back();
+        dat.data = reader.Data() + begin;
+        dat.size = (uint32_t)(reader.Tell() - begin);
+        dat.next_chunk = (uint32_t)(chunks_begin - begin);
+        ++n_lazy_assets_;
+
+        // Chunks' names count for inputs as if they were decoded
+        SetDatChunkNames(dat, true);
+        return;
+    }
+
+    /* Records which would not be copied back as they are get 
+    decoded, so that the output does not depend on lazy import */
+    DatBlock block;
+    reader.Seek(begin);
+    DecodeDatAsset(reader, block);
+    MergeDatChunks(i, block.chunks.data(), block.assets.front().n_chunks);
+}
+
+void AssetCacher::ImportExistAssetData(BinaryReader& reader)
+{
+    std::cout << "**Reading assets from the source .dat file\n";
+    ProgressBar bar(n_dat_assets_);
+
+    /* Records are indexed straight from the mapping, and only 
+    names met for the first time are copied as they are interned */
+    if (lazy_import_)
+    {
+        for (size_t n = 0; n < n_dat_assets_; ++n)
+        {
+            IndexDatAsset(reader);
+            ++bar;
+        }
+    }
+    else
+    {
+        DecodeDatBlocks(reader, n_dat_assets_, SkipDatAsset, DecodeDatAsset, 
+            [this, &bar](const DatBlock& block)
+            {
+                MergeDatAssets(block);
+                bar += block.n_records;
+            });
+    }
+    std::cout << '\n';
+    std::cout << n_dat_assets_ << " asset(s) imported.\n";
+}
+
+void AssetCacher::ImportExistInputData(BinaryReader& reader)
+{
+    std::cout << "**Reading input records from the source .dat file\n";
+    ProgressBar bar(n_inputs_);
+
+    DecodeDatBlocks(reader, n_inputs_, SkipDatInputs, DecodeDatInputs, 
+        [this, &bar](const DatBlock& block)
+        {
+            MergeDatInputs(block);
+            bar += block.n_records;
+        });
+    std::cout << '\n';
+    std::cout << n_inputs_ << " input record(s) imported.\n";
+}
+
+void AssetCacher::IndexExistInputData(BinaryReader& reader)
+{
+    std::cout << "**Indexing input records from the source .dat file\n";
+    ProgressBar bar(n_inputs_);
+
+    // Records of an asset usually follow each other
+    std::string_view last_name{};
+    size_t asset_index = 0;
+
+    for (size_t i = 0; i < n_inputs_; ++i)
+    {
+        size_t begin = reader.Tell();
+
+        std::string_view name = reader.ReadShortString();
+        if (name != last_name)
+        {
+            asset_index = assets_dict_.at(name);
+            last_name = name;
+        }
+
+        std::string_view chunk_name = reader.ReadShortString();
+        uint16_t n_chunk_inputs = reader.Read<uint16_t>();
+
+        reader.Seek(begin);
+        SkipDatInputs(reader);
+
+        /* Records which would not be copied as they are, such as 
+        ones out of the order of chunks, decode their asset */
+        AssetRecord& record = assets_[asset_index];
+        if (record.dat_record != AssetRecord::no_record && 
+            (!n_chunk_inputs || 
+            name != Asset::symbols.Name(record.name_id) || 
+            !SkipToDatChunk(dat_records_[record.dat_record], chunk_name)))
+        {
+            DecodeAsset(asset_index);
+        }
+
+        // Records of an asset decoded already are decoded as well
+        uint32_t r = record.dat_record;
+        if (r == AssetRecord::no_record)
+        {
+            DatBlock block;
+            reader.Seek(begin);
+            DecodeDatInputs(reader, block);
+            MergeDatInputs(block);
+            ++bar;
+            continue;
+        }
+
+        DatRecord& dat = dat_records_[r];
+        const char* data = reader.Data() + begin;
+        uint32_t size = (uint32_t)(reader.Tell() - begin);
+
+        // Adjacent records of the asset make up a single range
+        if (dat.last_inputs != DatRecord::no_range && 
+            dat_inputs_[dat.last_inputs].data + 
+                dat_inputs_[dat.last_inputs].size == data)
+        {
+            dat_inputs_[dat.last_inputs].size += size;
+        }
+        else
+        {
+            uint32_t range = (uint32_t)dat_inputs_.size();
+            dat_inputs_.push_back({ data, size });
+
+            if (dat.last_inputs == DatRecord::no_range) dat.first_inputs = range;
+            else dat_inputs_[dat.last_inputs].next = range;
+            dat.last_inputs = range;
+        }
+
+        ++dat.n_inputs;
+        ++bar;
+    }
+    std::cout << '\n';
+    std::cout << n_inputs_ << " input record(s) indexed.\n";
+}
+
+void AssetCacher::DecodeAsset(size_t i)
+{
+    AssetRecord& record = assets_[i];
+    if (record.dat_record == AssetRecord::no_record) return;
+
+    const DatRecord& dat = dat_records_[record.dat_record];
+    record.dat_record = AssetRecord::no_record;
+    --n_lazy_assets_;
+
+    DatBlock block;
+    BinaryReader reader(dat.data, dat.size);
+    DecodeDatAsset(reader, block);
+    MergeDatChunks(i, block.chunks.data(), block.assets.front().n_chunks);
+
+    for (uint32_t r = dat.first_inputs; 
+        r != DatRecord::no_range; r = dat_inputs_[r].next)
+    {
+        BinaryReader inputs(dat_inputs_[r].data, dat_inputs_[r].size);
+        while (!inputs.AtEnd()) DecodeDatInputs(inputs, block);
+    }
+    MergeDatInputs(block);
+}
+
+void AssetCacher::DecodeAssets()
+{
+    if (!n_lazy_assets_) return;
+
+    std::cout << "**Decoding records from the source .dat file\n";
+    ProgressBar bar(assets_.size());
+
+    size_t n_decoded = n_lazy_assets_;
+    for (size_t i = 0; i < assets_.size(); ++i)
+    {
+        DecodeAsset(i);
+        ++bar;
+    }
+    std::cout << '\n';
+    std::cout << n_decoded << " asset(s) decoded.\n";
+}
+
+void AssetCacher::ImportExistSourceData(uint64_t dat_size)
+{
+    augmented::ifstream ifs;
+    ifs.Map(root_path_ + "asset.dat.idx");
+
+    // Hashes of another .dat file are of no use
+    BinaryReader& reader = ifs.Reader();
+    if (!dat_size || ReadIdxHeader(reader) != dat_size) return;
+
+    std::cout << "**Reading content hashes from the source .idx file\n";
+
+    size_t n_sources = 0;
+    try
+    {
+        size_t n_records = reader.Read<uint32_t>();
+        ProgressBar bar(n_records);
+
+        for (; n_sources < n_records; ++n_sources)
+        {
+            std::string_view name = reader.ReadShortString();
+            std::string_view path = reader.ReadString<uint16_t>();
+            uint64_t content_hash = reader.Read<uint64_t>();
+
+            AssetsDict::iterator pos = assets_dict_.find(name);
+            if (pos != assets_dict_.end())
+            {
+                assets_[pos->second].source_id = Asset::symbols.Intern(path);
+                assets_[pos->second].content_hash = content_hash;
+            }
+
+            ++bar;
+        }
+    }
+    catch (const std::out_of_range&)
+    {
+        // Assets past the end of a truncated file are checked by time
+    }
+    std::cout << '\n';
+    std::cout << n_sources << " content hash(es) imported.\n";
+}
+
+void AssetCacher::SetChunkName(uint32_t name_id, bool is_set)
+{
+    uint32_t class_id = Asset::symbols.Class(name_id);
+    
+    if (class_id >= chunk_names_.size()) chunk_names_.resize(class_id + 1);
+    chunk_names_[class_id] = is_set;
+}
+
+bool AssetCacher::IsChunkName(uint32_t name_id) const
+{
+    uint32_t class_id = Asset::symbols.Class(name_id);
+    return class_id < chunk_names_.size() && chunk_names_[class_id];
+}
+
+void AssetCacher::SetDatChunkNames(const DatRecord& dat, bool is_set)
+{
+    BinaryReader reader(dat.data, dat.size);
+    reader.ReadShortString();
+    reader.Take(0x08); // the time
+
+    uint16_t n_chunks = reader.Read<uint16_t>();
+    for (uint16_t j = 0; j < n_chunks; ++j)
+    {
+        SetChunkName(Asset::symbols.Intern(reader.ReadShortString()), is_set);
+        reader.Take(0x0c); // tag, offset and size
+    }
+}
+
+bool AssetCacher::AreDatInputsResolved(const DatRecord& dat)
+{
+    for (uint32_t r = dat.first_inputs;
+        r != DatRecord::no_range; r = dat_inputs_[r].next)
+    {
+        BinaryReader reader(dat_inputs_[r].data, dat_inputs_[r].size);
+        while (!reader.AtEnd())
+        {
+            reader.ReadShortString(); // the asset's name
+            reader.ReadShortString(); // the chunk's name
+
+            uint16_t n_chunk_inputs = reader.Read<uint16_t>();
+            for (uint16_t j = 0; j < n_chunk_inputs; ++j)
+            {
+                if (!IsChunkName(Asset::symbols.Intern(
+                    reader.ReadShortString()))) return false;
+            }
+        }
+    }
+    return true;
+}
+
+void AssetCacher::AddAsset(Asset&& asset, size_t i)
+{
+    // Chunks without a place in .dat files are not cached
+    uint32_t n_chunks = 0;
+    for (const Asset::Chunk& chunk : asset.chunks)
+    {
+        n_chunks += Asset::Chunk::IsCached(chunk.type) ? 1 : 0;
+    }
+
+    // Removing old records in dictionaries
+    if (i < assets_.size() && 
+        n_chunks)
+    {
+        const AssetRecord& old = assets_[i];
+        assets_dict_.erase(Asset::symbols.Name(old.name_id), old.name_hash);
+    
+        if (old.dat_record != AssetRecord::no_record)
+        {
+            SetDatChunkNames(dat_records_[old.dat_record], false);
+        }
+
+        for (uint32_t c = old.first_chunk; 
+            c < old.first_chunk + old.n_chunks; ++c)
+        {
+            std::string_view chunk_name = 
+                Asset::symbols.Name(chunks_.name_ids[c]);
+            
+            chunks_dict_.erase(ChunkKey{ i, chunk_name }, 
+                ChunkKeyHasher::Combine(i, NameHash(chunk_name)));
+            SetChunkName(chunks_.name_ids[c], false);
+            n_inputs_ -= (chunks_.input_counts[c]) ? 1 : 0;
+        }
+    }
+
+    // Records of an asset imported lazily are dropped undecoded
+    if (i < assets_.size() && 
+        assets_[i].dat_record != AssetRecord::no_record)
+    {
+        n_inputs_ -= dat_records_[assets_[i].dat_record].n_inputs;
+        assets_[i].dat_record = AssetRecord::no_record;
+        --n_lazy_assets_;
+    }
+
+    /* Updating the asset and the asset dictionary.  Chunks 
+    of a replaced asset are left unused in the store. */
+    if (i == assets_.size()) assets_.emplace_back();
+
+    AssetRecord& record = assets_[i];
+    record.name_id = Asset::symbols.Intern(asset.name);
+    record.name_hash = asset.name_hash;
+    record.time = asset.time;
+    record.first_chunk = (uint32_t)chunks_.Size();
+    record.n_chunks = n_chunks;
+    record.source_id = AssetRecord::no_source;
+    record.content_hash = 0;
+
+    assets_dict_.emplace(Asset::symbols.Name(record.name_id), 
+        record.name_hash) = i;
+    
+    // Adding new records to chunk dictionaries
+    for (const Asset::Chunk& chunk : asset.chunks)
+    {
+        if (!Asset::Chunk::IsCached(chunk.type)) continue;
+        uint32_t c = chunks_.Append(chunk);
+
+        chunks_dict_.emplace({ i, Asset::symbols.Name(chunk.name_id) }, 
+            ChunkKeyHasher::Combine(i, chunk.Hash())) = c;
+        SetChunkName(chunk.name_id, true);
+        n_inputs_ += (chunk.inputs.size()) ? 1 : 0;
+    }
+}
+
+void AssetCacher::AddAsset(Asset&& asset)
+{
+    AddAsset(std::move(asset), assets_.size());
+}
+
+void AssetCacher::SetSource(size_t i, const FileRecord& file, 
+    uint64_t content_hash)
+{
+    assets_[i].source_id = Asset::symbols.Intern(SourcePath(file));
+    assets_[i].content_hash = content_hash;
+}
+
+size_t AssetCacher::AssetRecordSize(const AssetRecord& asset) const
+{
+    if (asset.dat_record != AssetRecord::no_record)
+    {
+        return dat_records_[asset.dat_record].size;
+    }
+
+    size_t size = BinaryWriter::ShortStringSize(
+        Asset::symbols.Name(asset.name_id));
+    size += sizeof(uint64_t) + sizeof(uint16_t); // time and chunk count
+
+    for (uint32_t c = asset.first_chunk; 
+        c < asset.first_chunk + asset.n_chunks; ++c)
+    {
+        size += BinaryWriter::ShortStringSize(
+            Asset::symbols.Name(chunks_.name_ids[c]));
+        size += 0x0c; // tag, offset and size
+    }
+    return size;
+}
+
+size_t AssetCacher::InputRecordsSize(const AssetRecord& asset) const
+{
+    size_t size = 0;
+
+    if (asset.dat_record != AssetRecord::no_record)
+    {
+        const DatRecord& dat = dat_records_[asset.dat_record];
+        for (uint32_t r = dat.first_inputs; 
+            r != DatRecord::no_range; r = dat_inputs_[r].next)
+        {
+            size += dat_inputs_[r].size;
+        }
+        return size;
+    }
+
+    size_t name_size = BinaryWriter::ShortStringSize(
+        Asset::symbols.Name(asset.name_id));
+
+    for (uint32_t c = asset.first_chunk; 
+        c < asset.first_chunk + asset.n_chunks; ++c)
+    {
+        uint32_t begin = chunks_.input_begins[c];
+        uint32_t end = begin + chunks_.input_counts[c];
+
+        size_t record_size = name_size + sizeof(uint16_t) + 
+            BinaryWriter::ShortStringSize(Asset::symbols.Name(chunks_.name_ids[c]));
+        size_t n_valid_inputs = 0;
+
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            if (!chunks_.validities[i]) continue;
+
+            record_size += BinaryWriter::ShortStringSize(
+                Asset::symbols.Name(chunks_.inputs[i]));
+            ++n_valid_inputs;
+        }
+
+        // Chunks without valid inputs have no record
+        if (n_valid_inputs) size += record_size;
+    }
+    return size;
+}
+
+void AssetCacher::WriteDatHeader(BinaryWriter& writer) const
+{
+    writer.Write("ALAE", 4);
+    writer.Write("\2\1\0\0", 4);
+
+    writer.Write((uint32_t)n_assets_);
+    writer.Write((uint32_t)n_inputs_);
+}
+
+void AssetCacher::WriteAssetRecord(BinaryWriter& writer, 
+    const AssetRecord& asset) const
+{
+    // Records which were never decoded are copied over
+    if (asset.dat_record != AssetRecord::no_record)
+    {
+        const DatRecord& dat = dat_records_[asset.dat_record];
+        writer.Write(dat.data, dat.size);
+        return;
+    }
+
+    writer.WriteShortString(Asset::symbols.Name(asset.name_id));
+    writer.Write<uint64_t>(asset.time);
+    writer.Write<uint16_t>(asset.n_chunks);
+
+    for (uint32_t c = asset.first_chunk; 
+        c < asset.first_chunk + asset.n_chunks; ++c)
+    {
+        Asset::Chunk::WriteInfoDat(writer, 
+            Asset::symbols.Name(chunks_.name_ids[c]), 
+            chunks_.types[c], chunks_.offsets[c], chunks_.sizes[c]);
+    }
+}
+
+size_t AssetCacher::WriteInputRecords(BinaryWriter& writer, 
+    const AssetRecord& asset) const
+{
+    if (asset.dat_record != AssetRecord::no_record)
+    {
+        const DatRecord& dat = dat_records_[asset.dat_record];
+        for (uint32_t r = dat.first_inputs; 
+            r != DatRecord::no_range; r = dat_inputs_[r].next)
+        {
+            writer.Write(dat_inputs_[r].data, dat_inputs_[r].size);
+        }
+        return dat.n_inputs;
+    }
+
+    size_t n_records = 0;
+
+    for (uint32_t c = asset.first_chunk; 
+        c < asset.first_chunk + asset.n_chunks; ++c)
+    {
+        uint32_t begin = chunks_.input_begins[c];
+        uint32_t end = begin + chunks_.input_counts[c];
+
+        size_t n_valid_inputs = 0;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            n_valid_inputs += chunks_.validities[i] ? 1 : 0;
+        }
+
+        if (!n_valid_inputs) continue;
+        
+        writer.WriteShortString(Asset::symbols.Name(asset.name_id));
+        writer.WriteShortString(Asset::symbols.Name(chunks_.name_ids[c]));
+        writer.Write<uint16_t>(n_valid_inputs);
+
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            if (!chunks_.validities[i]) continue;
+            writer.WriteShortString(Asset::symbols.Name(chunks_.inputs[i]));
+        }
+        ++n_records;
+    }
+    return n_records;
+}
+
+template <typename Export, typename Done>
+void AssetCacher::ExportBlocks(std::vector<ExportBlock>& blocks, 
+    Export&& export_block, Done&& done) const
+{
+    for (ExportBlock& block : blocks) block.ready.clear();
+
+    std::atomic<size_t> next_block = 0;
+    size_t n_workers = std::min<size_t>(n_threads_, blocks.size());
+
+    std::vector<std::jthread> workers;
+    workers.reserve(n_workers);
+
+    for (size_t i = 0; i < n_workers; ++i)
+    {
+        workers.emplace_back([&blocks, &next_block, 
+            &export_block](std::stop_token stop)
+            {
+                for (size_t b = next_block++; 
+                    b < blocks.size() && !stop.stop_requested(); 
+                    b = next_block++)
+                {
+                    try
+                    {
+                        export_block(blocks[b]);
+                    }
+                    catch (...)
+                    {
+                        // Errors are reported when the block is done with
+                        blocks[b].error = std::current_exception();
+                    }
+
+                    blocks[b].ready.test_and_set(std::memory_order_release);
+                    blocks[b].ready.notify_one();
+                }
+            });
+    }
+
+    // Blocks are done with on this thread in the order of assets
+    for (ExportBlock& block : blocks)
+    {
+        block.ready.wait(false, std::memory_order_acquire);
+        if (block.error) std::rethrow_exception(block.error);
+
+        done(block);
+    }
+}
+
+void AssetCacher::WriteOut(const OutputFile& file, BinaryWriter& writer, 
+    uint64_t& offset)
+{
+    if (!file.WriteAt(writer.Data(), writer.Size(), offset))
+    {
+        throw std::runtime_error("Unable to write the output file!");
+    }
+
+    offset += writer.Size();
+    writer.Clear();
+}
+
+/* Sizes of records are summed up by blocks on worker threads, 
+so that every block knows where its records go, and returns the 
+size of the whole file */
+uint64_t AssetCacher::LayOutData(std::vector<ExportBlock>& blocks) const
+{
+    BinaryWriter header;
+    WriteDatHeader(header);
+
+    uint64_t assets_end = header.Size();
+    uint64_t inputs_size = 0;
+
+    ExportBlocks(blocks, 
+        [this](ExportBlock& block)
+        {
+            for (size_t i = block.first_asset; 
+                i < block.first_asset + block.n_assets; ++i)
+            {
+                block.assets_size += AssetRecordSize(assets_[i]);
+                block.inputs_size += InputRecordsSize(assets_[i]);
+            }
+        }, 
+        [&assets_end, &inputs_size](ExportBlock& block)
+        {
+            block.assets_offset = assets_end;
+            block.inputs_offset = inputs_size; // until assets are all sized
+            assets_end += block.assets_size;
+            inputs_size += block.inputs_size;
+        });
+
+    for (ExportBlock& block : blocks) block.inputs_offset += assets_end;
+    return assets_end + inputs_size;
 }
 
-uint64_t AssetCacher::ReadDatHeader(std::ifstream& ifs)
+void AssetCacher::ExportAssetData(const OutputFile& file, 
+    std::vector<ExportBlock>& blocks) const
 {
-    if (!ifs.is_open()) return 0;
+    std::cout << "**Exporting asset data\n";
+    ProgressBar bar(n_assets_);
 
-    char signature[4];
-    *(uint32_t*)signature = ReadPrimitive<uint32_t>(ifs);
-    if (signature[0] != 'A' ||
-        signature[1] != 'L' ||
-        signature[2] != 'A' ||
-        signature[3] != 'E') return 0;
+    ExportBlocks(blocks, 
+        [this, &file](ExportBlock& block)
+        {
+            BinaryWriter writer;
+            writer.Reserve(std::min(block.assets_size, 2 * export_block_size));
+            uint64_t offset = block.assets_offset;
 
-    char version[4];
-    *(uint32_t*)version = ReadPrimitive<uint32_t>(ifs);
-    if (version[0] != '\2' ||
-        version[1] != '\1' ||
-        version[2] != '\0' ||
-        version[3] != '\0') return 0;
+            for (size_t i = block.first_asset; 
+                i < block.first_asset + block.n_assets; ++i)
+            {
+                WriteAssetRecord(writer, assets_[i]);
+                if (writer.Size() >= export_block_size) WriteOut(file, writer, offset);
+            }
+            WriteOut(file, writer, offset);
 
-    return ReadPrimitive<uint64_t>(ifs);
-}
+            if (offset != block.assets_offset + block.assets_size)
+            {
+                throw std::runtime_error("Asset records differ from their sizes!");
+            }
+        }, 
+        [&bar](const ExportBlock& block)
+        {
+            bar += block.n_assets;
+        });
 
-void AssetCacher::CountNewFiles()
-{
-    for (const std::filesystem::directory_entry& file :
-        std::filesystem::recursive_directory_iterator(root_path_))
-    {
-        n_assets_ += (IsValidFile(file)) ? 1 : 0;
-    }
+    std::cout << '\n';
+    std::cout << n_assets_ << " asset(s) exported.\n";
 }
 
-void AssetCacher::ImportExistAssetData(augmented::ifstream& ifs)
+void AssetCacher::ExportInputData(const OutputFile& file, 
+    std::vector<ExportBlock>& blocks) const
 {
-    std::cout << "**Reading assets from the source .dat file\n";
-    ProgressBar bar(n_dat_assets_);
+    std::cout << "**Exporting input records\n";
+    ProgressBar bar(n_inputs_);
 
-    for (size_t i = 0; i < n_dat_assets_; ++i)
-    {
-        assets_.emplace_back(ifs);
-        assets_dict_[assets_.back().name] = i;
+    ExportBlocks(blocks, 
+        [this, &file](ExportBlock& block)
+        {
+            BinaryWriter writer;
+            writer.Reserve(std::min(block.inputs_size, 2 * export_block_size));
+            uint64_t offset = block.inputs_offset;
+
+            for (size_t i = block.first_asset; 
+                i < block.first_asset + block.n_assets; ++i)
+            {
+                block.n_input_records += WriteInputRecords(writer, assets_[i]);
+                if (writer.Size() >= export_block_size) WriteOut(file, writer, offset);
+            }
+            WriteOut(file, writer, offset);
 
-        size_t j = 0;
-        for (const Asset::Chunk& chunk : assets_.back().chunks)
+            if (offset != block.inputs_offset + block.inputs_size)
+            {
+                throw std::runtime_error("Input records differ from their sizes!");
+            }
+        }, 
+        [&bar](const ExportBlock& block)
         {
-            chunks_dict_[i][chunk.name] = j++;
-            chunk_names_dict_[chunk.name] = { i, j };
-        }
+            bar += block.n_input_records;
+        });
 
-        ++bar;
-    }
     std::cout << '\n';
-    std::cout << n_dat_assets_ << " asset(s) imported.\n";
+    std::cout << n_inputs_ << " input record(s) exported.\n";
 }
 
-void AssetCacher::ImportExistInputData(augmented::ifstream& ifs)
+void AssetCacher::ExportSourceData(uint64_t dat_size) const
 {
-    using namespace std::string_view_literals;
+    std::cout << "**Exporting content hashes\n";
+    ProgressBar bar(n_assets_);
 
-    std::cout << "**Reading input records from the source .dat file\n";
-    ProgressBar bar(n_inputs_);
+    std::ofstream ofs(root_path_ + "asset.dat.idx", std::ios::binary);
+    if (!ofs.is_open()) throw std::runtime_error("Unable to write the .idx file!");
 
-    for (size_t i = 0; i < n_inputs_; ++i)
+    uint32_t n_sources = 0;
+    for (const AssetRecord& asset : assets_)
     {
-        std::string name = ReadShortString(ifs.FS());
-        size_t asset_index = assets_dict_.at(name);
+        n_sources += (asset.source_id != AssetRecord::no_source) ? 1 : 0;
+    }
 
-        name = ReadShortString(ifs.FS());
-        size_t chunk_index = chunks_dict_.at(asset_index).at(name);
-        
-        Asset::Chunk& chunk = assets_[asset_index].chunks[chunk_index];
-        chunk.inputs.reserve(ReadPrimitive<uint16_t>(ifs.FS()));
-        chunk.SetUpValidities();
+    BinaryWriter writer;
+    writer.Reserve(2 * export_block_size);
 
-        for (size_t j = 0; j < chunk.inputs.capacity(); ++j)
+    writer.Write("ACIX", 4);
+    writer.Write("\1\0\0\0", 4);
+    writer.Write<uint64_t>(dat_size);
+    writer.Write<uint32_t>(n_sources);
+
+    for (const AssetRecord& asset : assets_)
+    {
+        if (asset.source_id != AssetRecord::no_source)
         {
-            chunk.inputs.emplace_back(ReadShortString(ifs.FS()));
+            writer.WriteShortString(Asset::symbols.Name(asset.name_id));
+            writer.WriteString<uint16_t>(Asset::symbols.Name(asset.source_id));
+            writer.Write<uint64_t>(asset.content_hash);
         }
-        
+
+        if (writer.Size() >= export_block_size) writer.Flush(ofs);
         ++bar;
     }
+    writer.Flush(ofs);
+
     std::cout << '\n';
-    std::cout << n_inputs_ << " input record(s) imported.\n";
+    std::cout << n_sources << " content hash(es) exported.\n";
 }
 
-void AssetCacher::AddAsset(Asset&& asset, size_t i)
+uint64_t AssetCacher::DatTime() const
 {
-    // Removing old records in dictionaries
-    if (i < assets_.size() && 
-        asset.chunks.size())
+    std::error_code ec;
+    std::filesystem::file_time_type time = 
+        std::filesystem::last_write_time(root_path_ + "asset.dat", ec);
+
+    return ec ? 0 : Asset::ConvertFileTime(time);
+}
+
+uint64_t AssetCacher::DictFingerprint()
+{
+    /* Hashes and control bytes of snapshots are only valid while 
+    names are hashed, folded and probed the same way, which shows 
+    in the layout of dictionaries holding a few probe names */
+    constexpr std::string_view probes[] = 
     {
-        assets_dict_.erase(assets_[i].name);
-        chunks_dict_.at(i).clear();
-    
-        for (const Asset::Chunk& chunk : 
-            assets_[i].chunks)
-        {
-            chunk_names_dict_.erase(chunk.name);
-            n_inputs_ -= (chunk.inputs.size()) ? 1 : 0;
-        }
-    }
+        "asset.dat", "HLOD_SUB_OBJECT", "Mesh.Vertices_01", "\xc9t\xe9"
+    };
 
-    // Updating the asset and the asset dictionary
-    if (i < assets_.size()) assets_[i].swap(asset);
-    else assets_.emplace_back(std::move(asset));
-    assets_dict_[assets_[i].name] = i;
-    
-    // Adding new records to chunk dictionaries
-    size_t j = 0;
-    for (const Asset::Chunk& chunk : assets_[i].chunks)
+    AssetsDict assets_dict;
+    ChunksDict chunks_dict;
+    for (size_t i = 0; i < std::size(probes); ++i)
     {
-        chunks_dict_[i][chunk.name] = j++;
-        chunk_names_dict_[chunk.name] = { i, j };
-        n_inputs_ += (chunk.inputs.size()) ? 1 : 0;
+        assets_dict[probes[i]] = i;
+        chunks_dict[{ i, probes[i] }] = i;
     }
-}
 
-void AssetCacher::AddAsset(Asset&& asset)
-{
-    AddAsset(std::move(asset), assets_.size());
+    BinaryWriter writer;
+    writer.Write<uint64_t>(assets_dict.capacity());
+    writer.WriteArray(assets_dict.controls(), assets_dict.capacity());
+    writer.WriteArray(assets_dict.hashes(), assets_dict.capacity());
+    writer.Write<uint64_t>(chunks_dict.capacity());
+    writer.WriteArray(chunks_dict.controls(), chunks_dict.capacity());
+    writer.WriteArray(chunks_dict.hashes(), chunks_dict.capacity());
+
+    return ContentHash(writer.Data(), writer.Size());
 }
 
-void AssetCacher::WriteDatHeader(std::ofstream& ofs) const
+bool AssetCacher::ImportSnapshot(uint64_t dat_size, uint64_t dat_time)
 {
-    ofs.write("ALAE", 4);
-    ofs.write("\2\1\0\0", 4);
+    using namespace std::string_view_literals;
 
-    WritePrimitive(ofs, (uint32_t)n_assets_);
-    WritePrimitive(ofs, (uint32_t)n_inputs_);
-}
+    augmented::ifstream ifs;
+    ifs.Map(root_path_ + "asset.dat.snap");
 
-void AssetCacher::ExportAssetData(std::ofstream& ofs) const
-{
-    std::cout << "**Exporting asset data\n";
-    ProgressBar bar(n_assets_);
+    /* The snapshot must be of this very .dat file, undamaged and 
+    saved by a build hashing names the same way */
+    BinaryReader& reader = ifs.Reader();
+    if (!dat_size || !dat_time || reader.Size() < 0x28 + 0x08) return false;
 
-    for (const Asset& asset : assets_)
+    if (std::string_view(reader.Take(4), 4) != "ACSN"sv ||
+        reader.Read<uint32_t>() != snapshot_version ||
+        reader.Read<uint64_t>() != dat_size ||
+        reader.Read<uint64_t>() != dat_time ||
+        reader.Read<uint32_t>() != sizeof(size_t) ||
+        reader.Read<uint64_t>() != DictFingerprint())
     {
-        ofs << asset;
-        ++bar;
+        return false;
     }
-    std::cout << '\n';
-    std::cout << n_assets_ << " asset(s) exported.\n";
+
+    size_t body = reader.Tell();
+    uint64_t checksum;
+    std::memcpy(&checksum, reader.Data() + reader.Size() - 8, 8);
+    if (ContentHash(reader.Data() + body, reader.Size() - 8 - body) != checksum)
+    {
+        return false;
+    }
+
+    reader = BinaryReader(reader.Data(), reader.Size() - 8);
+    reader.Seek(body);
+
+    std::cout << "**Reading the index snapshot of the source .dat file\n";
+
+    try
+    {
+        std::vector<uint32_t> symbol_ids(reader.Read<uint32_t>());
+        for (uint32_t& id : symbol_ids)
+        {
+            id = Asset::symbols.Intern(reader.ReadString<uint16_t>());
+        }
+
+        auto global = [&symbol_ids](uint32_t id)
+        {
+            if (id >= symbol_ids.size()) throw std::out_of_range("Unknown name: ");
+            return symbol_ids[id];
+        };
+
+        // The snapshot must agree with the .dat file's header
+        if (reader.Read<uint64_t>() != n_inputs_ || 
+            reader.Read<uint32_t>() != n_dat_assets_)
+        {
+            throw std::out_of_range("Mismatched totals: ");
+        }
+
+        std::vector<AssetRecord> assets;
+        assets.reserve(n_assets_);
+        for (size_t i = 0; i < n_dat_assets_; ++i)
+        {
+            AssetRecord& asset = assets.emplace_back();
+            asset.name_id = global(reader.Read<uint32_t>());
+            asset.name_hash = (size_t)reader.Read<uint64_t>();
+            asset.time = reader.Read<uint64_t>();
+            asset.first_chunk = reader.Read<uint32_t>();
+            asset.n_chunks = reader.Read<uint32_t>();
+        }
+
+        ChunkStore chunks;
+        size_t n_chunks = reader.Read<uint32_t>();
+        chunks.types.resize(n_chunks);
+        chunks.offsets.resize(n_chunks);
+        chunks.sizes.resize(n_chunks);
+        chunks.name_ids.resize(n_chunks);
+        chunks.input_begins.resize(n_chunks);
+        chunks.input_counts.resize(n_chunks);
+
+        reader.ReadArray(chunks.types.data(), n_chunks);
+        reader.ReadArray(chunks.offsets.data(), n_chunks);
+        reader.ReadArray(chunks.sizes.data(), n_chunks);
+        reader.ReadArray(chunks.name_ids.data(), n_chunks);
+        reader.ReadArray(chunks.input_begins.data(), n_chunks);
+        reader.ReadArray(chunks.input_counts.data(), n_chunks);
+
+        chunks.inputs.resize(reader.Read<uint32_t>());
+        reader.ReadArray(chunks.inputs.data(), chunks.inputs.size());
+        chunks.validities.resize(chunks.inputs.size(), true);
+
+        for (uint32_t& id : chunks.name_ids) id = global(id);
+        for (uint32_t& id : chunks.inputs) id = global(id);
+
+        for (const AssetRecord& asset : assets)
+        {
+            if ((uint64_t)asset.first_chunk + asset.n_chunks > n_chunks)
+            {
+                throw std::out_of_range("Chunk out of range: ");
+            }
+        }
+
+        for (size_t c = 0; c < n_chunks; ++c)
+        {
+            if ((uint64_t)chunks.input_begins[c] + chunks.input_counts[c] > 
+                chunks.inputs.size())
+            {
+                throw std::out_of_range("Input out of range: ");
+            }
+        }
+
+        /* Dictionaries are restored as they were laid out, keys 
+        being the names of the records their slots point to */
+        AssetsDict assets_dict;
+        {
+            size_t capacity = (size_t)reader.Read<uint64_t>();
+            size_t growth_left = (size_t)reader.Read<uint64_t>();
+            if (capacity > reader.Size()) throw std::out_of_range("Dictionary out of range: ");
+
+            std::vector<int8_t> controls(capacity);
+            std::vector<size_t> hashes(capacity);
+            std::vector<uint32_t> values(capacity);
+            reader.ReadArray(controls.data(), capacity);
+            reader.ReadArray(hashes.data(), capacity);
+            reader.ReadArray(values.data(), capacity);
+
+            assets_dict.restore(controls.data(), hashes.data(), capacity, 
+                [&](size_t i) -> AssetsDict::value_type
+                {
+                    if (values[i] >= assets.size() || 
+                        hashes[i] != assets[values[i]].name_hash) 
+                        throw std::out_of_range("Asset out of range: ");
+                    return { Asset::symbols.Name(assets[values[i]].name_id), 
+                        values[i] };
+                });
+
+            if (assets_dict.growth_left() != growth_left) 
+                throw std::out_of_range("Dictionary layout mismatch: ");
+        }
+
+        ChunksDict chunks_dict;
+        {
+            size_t capacity = (size_t)reader.Read<uint64_t>();
+            size_t growth_left = (size_t)reader.Read<uint64_t>();
+            if (capacity > reader.Size()) throw std::out_of_range("Dictionary out of range: ");
+
+            std::vector<int8_t> controls(capacity);
+            std::vector<size_t> hashes(capacity);
+            std::vector<uint32_t> values(capacity);
+            std::vector<uint32_t> owners(capacity);
+            reader.ReadArray(controls.data(), capacity);
+            reader.ReadArray(hashes.data(), capacity);
+            reader.ReadArray(values.data(), capacity);
+            reader.ReadArray(owners.data(), capacity);
+
+            // A chunk's slot belongs to the asset the chunk is in
+            chunks_dict.restore(controls.data(), hashes.data(), capacity, 
+                [&](size_t i) -> ChunksDict::value_type
+                {
+                    if (owners[i] >= assets.size() || 
+                        values[i] < assets[owners[i]].first_chunk || 
+                        values[i] - assets[owners[i]].first_chunk >= 
+                            assets[owners[i]].n_chunks) 
+                        throw std::out_of_range("Chunk out of range: ");
+                    return { ChunkKey{ owners[i], 
+                        Asset::symbols.Name(chunks.name_ids[values[i]]) }, 
+                        values[i] };
+                });
+
+            if (chunks_dict.growth_left() != growth_left) 
+                throw std::out_of_range("Dictionary layout mismatch: ");
+        }
+
+        if (!reader.AtEnd()) throw std::out_of_range("Trailing data: ");
+
+        // Nothing is taken over until the whole snapshot is read
+        assets_.swap(assets);
+        std::swap(chunks_, chunks);
+        assets_dict_ = std::move(assets_dict);
+        chunks_dict_ = std::move(chunks_dict);
+
+        for (uint32_t name_id : chunks_.name_ids) SetChunkName(name_id, true);
+    }
+    catch (const std::exception& e)
+    {
+        // Names interned on the way are harmless
+        std::cout << e.what() << "the snapshot is skipped.\n";
+        return false;
+    }
+
+    std::cout << n_dat_assets_ << " asset(s) and " << chunks_.Size() << 
+        " chunk(s) imported.\n";
+    return true;
 }
 
-void AssetCacher::ExportInputData(std::ofstream& ofs) const
+void AssetCacher::ExportSnapshot(uint64_t dat_size, uint64_t dat_time) const
 {
-    std::cout << "**Exporting input records\n";
-    ProgressBar bar(n_inputs_);
+    std::cout << "**Exporting the index snapshot\n";
 
-    size_t i = 0;
-    for (const Asset& asset : assets_)
+    constexpr static uint32_t no_id = UINT32_MAX;
+
+    /* Names are numbered anew in the order they are met, since 
+    ids of the symbol table are only valid within a run */
+    std::vector<uint32_t> local_ids;
+    std::vector<uint32_t> symbol_ids;
+    auto local = [&local_ids, &symbol_ids](uint32_t id)
+    {
+        if (id >= local_ids.size()) local_ids.resize(id + 1, no_id);
+        if (local_ids[id] == no_id)
+        {
+            local_ids[id] = (uint32_t)symbol_ids.size();
+            symbol_ids.push_back(id);
+        }
+
+        return local_ids[id];
+    };
+
+    BinaryWriter records;
+    records.Write<uint64_t>(n_inputs_);
+    records.Write<uint32_t>((uint32_t)assets_.size());
+
+    // Chunks of replaced assets are left out of the snapshot
+    std::vector<uint32_t> chunk_ids(chunks_.Size(), no_id);
+    uint32_t n_chunks = 0;
+
+    for (const AssetRecord& asset : assets_)
     {
-        for (const Asset::Chunk& chunk : asset.chunks)
+        records.Write<uint32_t>(local(asset.name_id));
+        records.Write<uint64_t>(asset.name_hash);
+        records.Write<uint64_t>(asset.time);
+        records.Write<uint32_t>(n_chunks);
+        records.Write<uint32_t>(asset.n_chunks);
+
+        for (uint32_t c = asset.first_chunk; 
+            c < asset.first_chunk + asset.n_chunks; ++c)
+        {
+            chunk_ids[c] = n_chunks++;
+        }
+    }
+
+    // Chunks are kept column by column, as in the store
+    {
+        ChunkStore chunks;
+        chunks.Reserve(n_chunks);
+
+        for (const AssetRecord& asset : assets_)
         {
-            size_t n_valid_inputs = 0;
-            for (size_t i = 0; i < chunk.inputs.size(); ++i)
+            for (uint32_t c = asset.first_chunk; 
+                c < asset.first_chunk + asset.n_chunks; ++c)
             {
-                n_valid_inputs += chunk.IsValidInput(i) ? 1 : 0;
+                chunks.types.push_back(chunks_.types[c]);
+                chunks.offsets.push_back(chunks_.offsets[c]);
+                chunks.sizes.push_back(chunks_.sizes[c]);
+                chunks.name_ids.push_back(local(chunks_.name_ids[c]));
+
+                // Invalid inputs are left out, as they are in .dat files
+                chunks.input_begins.push_back((uint32_t)chunks.inputs.size());
+                uint32_t begin = chunks_.input_begins[c];
+                for (uint32_t i = begin; i < begin + chunks_.input_counts[c]; ++i)
+                {
+                    if (chunks_.validities[i]) 
+                        chunks.inputs.push_back(local(chunks_.inputs[i]));
+                }
+                chunks.input_counts.push_back(
+                    (uint32_t)chunks.inputs.size() - chunks.input_begins.back());
             }
+        }
 
-            if (!n_valid_inputs) continue;
-            
-            WriteShortString(ofs, asset.name);
-            WriteShortString(ofs, chunk.name);
-            WritePrimitive<uint16_t>(ofs, n_valid_inputs);
+        records.Write<uint32_t>(n_chunks);
+        records.WriteArray(chunks.types.data(), n_chunks);
+        records.WriteArray(chunks.offsets.data(), n_chunks);
+        records.WriteArray(chunks.sizes.data(), n_chunks);
+        records.WriteArray(chunks.name_ids.data(), n_chunks);
+        records.WriteArray(chunks.input_begins.data(), n_chunks);
+        records.WriteArray(chunks.input_counts.data(), n_chunks);
+
+        records.Write<uint32_t>((uint32_t)chunks.inputs.size());
+        records.WriteArray(chunks.inputs.data(), chunks.inputs.size());
+    }
+
+    // Dictionaries are saved slot by slot, as they are laid out
+    {
+        size_t capacity = assets_dict_.capacity();
+        records.Write<uint64_t>(capacity);
+        records.Write<uint64_t>(assets_dict_.growth_left());
+        records.WriteArray(assets_dict_.controls(), capacity);
+        records.WriteArray(assets_dict_.hashes(), capacity);
+
+        for (size_t i = 0; i < capacity; ++i)
+        {
+            records.Write<uint32_t>((assets_dict_.controls()[i] < 0) ? 
+                0 : (uint32_t)assets_dict_.slot(i).second);
+        }
+    }
+
+    {
+        /* Entries for chunks of replaced assets turn into 
+        tombstones, which keeps probing for others intact */
+        size_t capacity = chunks_dict_.capacity();
+        std::vector<int8_t> controls(chunks_dict_.controls(), 
+            chunks_dict_.controls() + capacity);
+        std::vector<uint32_t> values(capacity);
+        std::vector<uint32_t> assets(capacity);
 
-            for (size_t i = 0; i < chunk.inputs.size(); ++i)
+        for (size_t i = 0; i < capacity; ++i)
+        {
+            if (controls[i] < 0) continue;
+
+            uint32_t c = chunk_ids[chunks_dict_.slot(i).second];
+            if (c == no_id)
             {
-                if (!chunk.IsValidInput(i)) continue;
-                WriteShortString(ofs, chunk.inputs[i]);
+                controls[i] = ChunksDict::tombstone;
+                continue;
             }
 
-            ++bar;
+            values[i] = c;
+            assets[i] = (uint32_t)chunks_dict_.slot(i).first.asset;
         }
+
+        records.Write<uint64_t>(capacity);
+        records.Write<uint64_t>(chunks_dict_.growth_left());
+        records.WriteArray(controls.data(), capacity);
+        records.WriteArray(chunks_dict_.hashes(), capacity);
+        records.WriteArray(values.data(), capacity);
+        records.WriteArray(assets.data(), capacity);
     }
-    std::cout << '\n';
-    std::cout << n_inputs_ << " input record(s) exported.\n";
+
+    BinaryWriter writer;
+    writer.Write("ACSN", 4);
+    writer.Write<uint32_t>(snapshot_version);
+    writer.Write<uint64_t>(dat_size);
+    writer.Write<uint64_t>(dat_time);
+    writer.Write<uint32_t>(sizeof(size_t)); // hashes are saved as they are
+    writer.Write<uint64_t>(DictFingerprint());
+
+    size_t body = writer.Size();
+    writer.Write<uint32_t>((uint32_t)symbol_ids.size());
+    for (uint32_t id : symbol_ids)
+    {
+        writer.WriteString<uint16_t>(Asset::symbols.Name(id));
+    }
+    writer.Write(records.Data(), records.Size());
+
+    // A damaged snapshot is never taken for a valid one
+    writer.Write<uint64_t>(ContentHash(writer.Data() + body, 
+        writer.Size() - body));
+
+    std::ofstream ofs(root_path_ + "asset.dat.snap", std::ios::binary);
+    writer.Flush(ofs);
+
+    // The snapshot only speeds up the next run, so it may be missing
+    if (!ofs)
+    {
+        ofs.close();
+        std::error_code ec;
+        std::filesystem::remove(root_path_ + "asset.dat.snap", ec);
+        std::cout << "Unable to write the index snapshot.\n";
+        return;
+    }
+
+    std::cout << assets_.size() << " asset(s) and " << n_chunks << 
+        " chunk(s) exported to the snapshot.\n";
 }
 
 void AssetCacher::ImportExistData()
 {
-    augmented::ifstream ifs(root_path_ + "asset.dat",
-        std::ios::binary);
+    // The mapping is kept, as names are interned as views into it
+    dat_map_.Open(root_path_ + "asset.dat");
+    BinaryReader reader(dat_map_.Data(), dat_map_.Size());
     
     {
-        uint64_t totals = ReadDatHeader(ifs.FS());
+        uint64_t totals = ReadDatHeader(reader);
         n_dat_assets_ = ((uint32_t*)&totals)[0];
         n_assets_ += n_dat_assets_;
         n_inputs_ += ((uint32_t*)&totals)[1];
@@ -216,17 +1618,27 @@ void AssetCacher::ImportExistData()
 
     assets_.reserve(n_assets_);
 
-    if (n_dat_assets_ && 
+    /* The snapshot of the index spares reading records one 
+    by one and hashing every name in them */
+    bool is_restored = assets_.empty() && n_dat_assets_ && 
+        ImportSnapshot(reader.Size(), DatTime());
+
+    if (!is_restored && 
+        n_dat_assets_ && 
         n_assets_ == (uint32_t)n_assets_)
     {
-        ImportExistAssetData(ifs);
+        ImportExistAssetData(reader);
     }
 
-    if (n_inputs_ &&
+    if (!is_restored && 
+        n_inputs_ &&
         n_inputs_ == (uint32_t)n_inputs_)
     {
-        ImportExistInputData(ifs);
+        if (lazy_import_) IndexExistInputData(reader);
+        else ImportExistInputData(reader);
     }
+
+    if (content_hashing_) ImportExistSourceData(reader.Size());
 }
 
 void AssetCacher::ImportNewData()
@@ -240,48 +1652,175 @@ void AssetCacher::ImportNewData()
 
     std::cout << "**Reading asset files\n";
 
-    /* Non-zero size of assets_ can arise only from 
-    assets picked from the source .dat file with 
-    incremental generation. */
-    ProgressBar bar(n_assets_ - assets_.size());
+    ProgressBar bar(manifest_.size());
     size_t n_new_assets = 0;
     size_t n_upd_assets = 0;
+    size_t n_kept_assets = 0;
+    size_t n_restored_assets = 0;
 
-    size_t i = 0;
-    for (const std::filesystem::directory_entry& file :
-        std::filesystem::recursive_directory_iterator(root_path_))
+    // Files that need to be parsed in the order of the manifest
+    std::vector<const FileRecord*> files;
+    files.reserve(manifest_.size());
+
+    std::vector<std::optional<uint64_t>> last_hashes;
+    if (content_hashing_) last_hashes.reserve(manifest_.size());
+
+    for (const FileRecord& record : manifest_)
     {
-        if (!file.is_regular_file()) continue;
+        /* With content hashing, the source of a cached asset 
+        is read anyway to see if its contents have changed */
+        const AssetRecord* source = content_hashing_ ? 
+            FindSource(record) : nullptr;
 
-        augmented::ifstream ifs;
+        if (source || !IsUpToDate(record))
         {
-            std::string path = file.path().string();
-            for (char& c : path) c = std::tolower(c);
+            files.push_back(&record);
+            if (content_hashing_)
+            {
+                last_hashes.push_back(source ? 
+                    std::optional(source->content_hash) : std::nullopt);
+            }
+            continue;
+        }
+
+        ++n_kept_assets;
+        ++bar;
+    }
+
+    /* Files are mapped on I/O threads ahead of parsing, so that 
+    up to n_reads files are opened and read in the background at 
+    any time instead of waiting on one file after another. */
+    std::vector<ParsedFile> parsed(files.size());
+    for (size_t i = 0; i < last_hashes.size(); ++i)
+    {
+        parsed[i].is_hashed = true;
+        parsed[i].last_hash = last_hashes[i];
+    }
 
-            ifs.Open(std::move(path), std::ios::binary,
-                formats, true);
+    // Models are looked up in the parse cache by their hashes
+    if (parse_cache_)
+    {
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            parsed[i].is_hashed |= 
+                files[i]->type == FileRecord::Type::Model;
         }
-        if (!ifs.FS().is_open()) continue;
+    }
+
+    std::atomic<size_t> next_read = 0;
+    std::atomic<size_t> next_file = 0;
+
+    unsigned int n_reads = n_reads_ ? n_reads_ : 4 * n_threads_;
+    std::counting_semaphore<> reads_in_flight(n_reads);
+
+    std::vector<std::jthread> io_workers;
+    io_workers.reserve(std::min(n_reads, max_io_threads));
+
+    for (unsigned int i = 0; i < io_workers.capacity(); ++i)
+    {
+        io_workers.emplace_back([&files, &parsed, &next_read, 
+            &reads_in_flight](std::stop_token stop)
+            {
+                // A thread waiting for a slot is woken up to stop
+                std::stop_callback wake(stop, 
+                    [&reads_in_flight] { reads_in_flight.release(); });
+
+                while (true)
+                {
+                    // A slot is freed once a mapped file is parsed
+                    reads_in_flight.acquire();
+                    if (stop.stop_requested()) return;
+                    
+                    size_t i = next_read++;
+                    if (i >= files.size())
+                    {
+                        reads_in_flight.release();
+                        return;
+                    }
+
+                    MapFile(*files[i], parsed[i]);
+                }
+            });
+    }
+
+    /* Files are parsed on worker threads, while assets are 
+    merged on this thread strictly in the order of the manifest. 
+    Hence, the output does not depend on the number of threads. */
+    std::vector<std::jthread> workers;
+    workers.reserve(n_threads_);
+
+    for (unsigned int i = 0; i < n_threads_; ++i)
+    {
+        workers.emplace_back([&files, &parsed, &next_file, 
+            &reads_in_flight, cache = parse_cache_.get()](std::stop_token stop)
+            {
+                for (size_t i = next_file++; 
+                    i < files.size() && !stop.stop_requested(); 
+                    i = next_file++)
+                {
+                    ParseFile(*files[i], parsed[i], 
+                        (files[i]->type == FileRecord::Type::Model) ? 
+                        cache : nullptr);
+                    reads_in_flight.release();
+                }
+            });
+    }
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        parsed[i].ready.wait(false, std::memory_order_acquire);
 
         try
         {
-            Asset asset(ifs);
+            if (parsed[i].error) std::rethrow_exception(parsed[i].error);
+            if (parsed[i].is_unchanged)
+            {
+                ++n_kept_assets;
+                ++bar;
+                continue;
+            }
+
+            if (!parsed[i].asset)
+            {
+                ++bar;
+                continue;
+            }
+
+            n_restored_assets += parsed[i].is_restored ? 1 : 0;
+
+            Asset& asset = *parsed[i].asset;
             AssetsDict::iterator pos =
-                assets_dict_.find(asset.name);
+                assets_dict_.find(asset.name, asset.name_hash);
             
             // The case of a new asset
             if (pos == assets_dict_.end())
             {
                 AddAsset(std::move(asset));
                 ++n_new_assets;
+
+                if (content_hashing_)
+                {
+                    SetSource(assets_.size() - 1, *files[i], 
+                        parsed[i].content_hash);
+                }
             }
             /* The case of an overlapping asset.
-            Is it newer than the one already included? */
-            else if (asset > assets_[pos->second])
+            Is it newer than the one already included?  The 
+            changed source of the asset replaces it anyway. */
+            else if (asset.name == Asset::symbols.Name(
+                    assets_[pos->second].name_id) && 
+                (asset.time > assets_[pos->second].time || 
+                    (parsed[i].last_hash && 
+                    FindSource(*files[i]) == &assets_[pos->second])))
             {
-                size_t i = pos->second; // index of the asset to be replaced
-                AddAsset(std::move(asset), i);
+                size_t j = pos->second; // index of the asset to be replaced
+                AddAsset(std::move(asset), j);
                 ++n_upd_assets;
+
+                if (content_hashing_)
+                {
+                    SetSource(j, *files[i], parsed[i].content_hash);
+                }
             }
         }
         catch (const Asset::invalid_file_format& e)
@@ -289,26 +1828,59 @@ void AssetCacher::ImportNewData()
             std::cerr << e.what() << '\n';
         }
 
+        parsed[i].asset.reset();
         ++bar;
     }
     std::cout << '\n';
     std::cout << n_new_assets << " asset(s) added.\n";
     std::cout << n_upd_assets << " asset(s) updated.\n";
+    std::cout << n_kept_assets << " asset(s) unchanged.\n";
+    if (parse_cache_)
+    {
+        std::cout << n_restored_assets << " model(s) taken from the parse cache.\n";
+    }
 
     n_assets_ = assets_.size();
 }
 
+void AssetCacher::SetThreads(unsigned int n_threads)
+{
+    n_threads_ = n_threads ? n_threads : 
+        std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void AssetCacher::SetReadsInFlight(unsigned int n_reads)
+{
+    n_reads_ = n_reads;
+}
+
+void AssetCacher::SetContentHashing(bool is_enabled)
+{
+    content_hashing_ = is_enabled;
+}
+
+void AssetCacher::SetParseCache(std::unique_ptr<ParseCacheBackend> cache)
+{
+    parse_cache_ = std::move(cache);
+}
+
+void AssetCacher::SetLazyImport(bool is_enabled)
+{
+    lazy_import_ = is_enabled;
+}
+
 void AssetCacher::ValidateInputs()
 {
-    ProcessInputs([](Asset::Chunk&, size_t i) {}, 
+    // Inputs of every asset are checked against chunks of all assets
+    ProcessInputs([](size_t) {}, 
         [](size_t n_valid_inputs) { return n_valid_inputs; });
 }
 
 void AssetCacher::FilterInputs()
 {
-    ProcessInputs([](Asset::Chunk& chunk, size_t i)
+    ProcessInputs([this](size_t i)
         {
-            chunk.InvalidateInput(i);
+            chunks_.validities[i] = false;
         }, 
         [](size_t n_valid_inputs) 
         { 
@@ -316,50 +1888,84 @@ void AssetCacher::FilterInputs()
         });
 }
 
-void AssetCacher::ExportData() const
+void AssetCacher::ExportData()
 {
     using namespace std::filesystem;
 
-    // Backing up the existing .dat file (if there is such)
+    /* Backing up the existing .dat file (if there is such). 
+    It is moved rather than copied and overwritten, as names 
+    imported from it may still be read through its mapping. */
     {
         std::error_code ec;
-        copy_file(root_path_ + "asset.dat", 
+        rename(root_path_ + "asset.dat", 
             root_path_ + "asset.dat.bak", 
-            std::filesystem::copy_options::overwrite_existing, 
             ec);
+
+        if (ec && dat_map_.Data() && 
+            exists(root_path_ + "asset.dat", ec))
+        {
+            throw std::runtime_error("Unable to back up the existing .dat file!");
+        }
     }
     
     path output_path(root_path_ + "asset.dat");
-    std::ofstream ofs(output_path, std::ios::binary); // <-- File picker window here in the future...
-    if (ofs.bad()) throw std::runtime_error("Unable to write the output file!");
-
-    WriteDatHeader(ofs);
+    OutputFile file(output_path); // <-- File picker window here in the future...
+    if (!file.IsOpen()) throw std::runtime_error("Unable to write the output file!");
 
+    /* Offsets of all records are known up front from their sizes, 
+    so the file is sized at once, and worker threads serialize 
+    blocks of assets and write them straight to their places.  
+    The output does not depend on the number of threads. */
+    uint64_t dat_size = 0;
     try
     {
-        ExportAssetData(ofs);
+        size_t n_blocks = (assets_.size() + export_block_assets - 1) / 
+            export_block_assets;
+
+        std::vector<ExportBlock> blocks(n_blocks);
+        for (size_t b = 0; b < n_blocks; ++b)
+        {
+            blocks[b].first_asset = b * export_block_assets;
+            blocks[b].n_assets = std::min(export_block_assets, 
+                assets_.size() - blocks[b].first_asset);
+        }
+
+        dat_size = LayOutData(blocks);
+        if (!file.Resize(dat_size)) throw std::runtime_error("Unable to write the output file!");
+
+        BinaryWriter header;
+        WriteDatHeader(header);
+        uint64_t offset = 0;
+        WriteOut(file, header, offset);
+
+        ExportAssetData(file, blocks);
+        ExportInputData(file, blocks);
+
+        if (!file.Close()) throw std::runtime_error("Unable to write the output file!");
     }
     catch(const std::exception& e)
     {
-        ofs.close();
+        file.Close();
 
         std::error_code ec;
         remove(output_path, ec);
 
         throw std::runtime_error(e.what());
     }
-    
-    try
+
+    /* Content hashes and the snapshot belong to this very 
+    .dat file, so stale ones are never left behind */
     {
-        ExportInputData(ofs);
+        std::error_code ec;
+        remove(root_path_ + "asset.dat.idx", ec);
+        remove(root_path_ + "asset.dat.snap", ec);
     }
-    catch(const std::exception& e)
-    {
-        ofs.close();
 
-        std::error_code ec;
-        remove(output_path, ec);
+    if (content_hashing_) ExportSourceData(dat_size);
 
-        throw std::runtime_error(e.what());
-    }
+    /* Records which were copied over undecoded are decoded only 
+    now, from the backed up mapping, so that the snapshot covers 
+    them and the next run is spared importing the .dat file */
+    DecodeAssets();
+    ExportSnapshot(dat_size, DatTime());
 }
\ No newline at end of file
@@ -1,84 +1,253 @@
 #pragma once
 #include "w3d.h"
+#include "chunk_store.h"
 #include "binary_io.h"
+#include "mapped_file.h"
+#include "output_file.h"
 #include "container_utils.h"
+#include "flat_hash_map.h"
+#include "name_hash.h"
+#include "content_hash.h"
+#include "parse_cache.h"
 #include "console_progress_bar.h"
 
-#include <cwctype>
-
 #include <iostream>
 #include <format>
 
 #include <vector>
-#include <unordered_map>
+#include <memory>
+#include <optional>
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <semaphore>
+#include <thread>
 
 #include <filesystem>
 
 class AssetCacher
 {
 private:
+    // Case-neutral string hasher, see name_hash.h
     template <typename SV>
     struct CN_Hasher
     {
-        /* A case-neutral implementation of 
-        the DJB2 algorithm.  See the following 
-        for further discussion and other algorithms: 
-        http://www.cse.yorku.ca/~oz/hash.html */
-        size_t operator()(SV sv) const
-        {
-            size_t hash = 5381;
-
-            for (size_t i = 0; i < sv.size(); ++i)
-            {
-                char c = std::towlower(sv[i]);
-                hash = hash * 33 ^ c;
-            }
-            
-            return hash;
-        }
+        size_t operator()(SV sv) const { return NameHash(sv); }
     };
 
     // Case-neutral string comparator
     template <typename SV>
     struct CN_Equals
     {
-    private:
-        bool CompareEqualLength(SV sv1, SV sv2) const
+        bool operator()(SV sv1, SV sv2) const { return NameEquals(sv1, sv2); }
+    };
+    
+    using File = std::filesystem::directory_entry;
+
+    // An asset file picked up by the directory scan
+    struct FileRecord
+    {
+        enum class Type : uint8_t
         {
-            for (size_t i = 0; i < sv1.size(); ++i)
-            {
-                if (sv1[i] == sv2[i]) continue;
-                if (std::towlower(sv1[i]) == 
-                    std::towlower(sv2[i])) continue;
-                return false;
-            }
-            
-            return true;
+            Texture = 0,
+            Model
+        };
+
+        std::string path{}; // lower-case path to the file
+        Type type = Type::Texture;
+        size_t size = 0;
+        uint64_t time = 0; // last write time in Windows' format
+    };
+
+    // A file passing through the reading and parsing stages
+    struct ParsedFile
+    {
+        MappedFile map{}; // handed over to the parser once mapped
+        std::atomic_flag mapped{}; // set once the file is mapped
+
+        // With content hashing, the file is hashed as it is mapped
+        bool is_hashed = false;
+        std::optional<uint64_t> last_hash{}; // the hash of the cached asset's source
+        uint64_t content_hash = 0;
+        bool is_unchanged = false; // the hash is the same, so the file is not parsed
+        bool is_restored = false; // taken from the parse cache instead of parsing
+
+        std::optional<Asset> asset{};
+        std::exception_ptr error{};
+        std::atomic_flag ready{}; // set once the file is processed
+    };
+
+    // A cached asset, whose chunks are kept in the chunk store
+    struct AssetRecord
+    {
+        constexpr static uint32_t no_source = UINT32_MAX;
+        constexpr static uint32_t no_record = UINT32_MAX;
+
+        uint32_t name_id = 0; // the name's id in the symbol table
+        size_t name_hash = 0;
+        uint64_t time = 0;
+
+        // The file the asset comes from, known with content hashing
+        uint32_t source_id = no_source; // the path's id in the symbol table
+        uint64_t content_hash = 0;
+
+        // Records of the source .dat file yet to be decoded, if any
+        uint32_t dat_record = no_record; // the index in dat_records_
+
+        // The range of the asset's chunks
+        uint32_t first_chunk = 0;
+        uint32_t n_chunks = 0;
+    };
+
+    /* Records of an asset imported lazily from the source .dat 
+    file, which are kept as byte ranges of the mapping until the 
+    asset's chunks are needed */
+    struct DatRecord
+    {
+        const char* data = nullptr; // the asset record
+        uint32_t size = 0;
+
+        // Input records of the asset chained over dat_inputs_
+        uint32_t first_inputs = no_range;
+        uint32_t last_inputs = no_range;
+        uint32_t n_inputs = 0; // the total of input records
+
+        // Where chunk records left for input records to refer to begin
+        uint32_t next_chunk = 0;
+
+        constexpr static uint32_t no_range = UINT32_MAX;
+    };
+
+    // Consecutive input records of a single asset
+    struct DatRange
+    {
+        const char* data = nullptr;
+        uint32_t size = 0;
+        uint32_t next = DatRecord::no_range;
+    };
+
+    // A chunk record decoded from the source .dat file
+    struct DatChunk
+    {
+        ChunkType type{};
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        uint32_t name_id = 0;
+        size_t name_hash = 0;
+    };
+
+    // An input record decoded from the source .dat file
+    struct DatInputs
+    {
+        std::string_view asset{};
+        size_t asset_hash = 0;
+        std::string_view chunk{};
+        size_t chunk_hash = 0;
+        uint32_t n_inputs = 0; // the ids follow those of preceding records
+    };
+
+    /* Consecutive records of the source .dat file decoded on a
+    worker thread, which are then merged into the dictionaries */
+    struct DatBlock
+    {
+        size_t begin = 0; // the offset of the first record
+        size_t n_records = 0;
+
+        std::vector<AssetRecord> assets{}; // chunks are counted, not placed
+        std::vector<DatChunk> chunks{};
+        std::vector<DatInputs> input_records{};
+        std::vector<uint32_t> inputs{}; // the inputs' name ids
+
+        std::exception_ptr error{};
+        std::atomic_flag ready{}; // set once the block is decoded
+    };
+
+    /* Records of consecutive assets, which a worker thread writes 
+    straight to their place in asset.dat */
+    struct ExportBlock
+    {
+        size_t first_asset = 0;
+        size_t n_assets = 0;
+
+        // Sizes of the block's records, then their offsets in the file
+        size_t assets_size = 0;
+        size_t inputs_size = 0;
+        uint64_t assets_offset = 0;
+        uint64_t inputs_offset = 0;
+        size_t n_input_records = 0;
+
+        std::exception_ptr error{};
+        std::atomic_flag ready{}; // set once the block is done with
+    };
+
+    // A chunk's name within the asset of the index
+    struct ChunkKey
+    {
+        size_t asset = 0;
+        std::string_view name{};
+    };
+
+    struct ChunkKeyHasher
+    {
+        size_t operator()(const ChunkKey& key) const
+        {
+            return Combine(key.asset, NameHash(key.name));
         }
 
-    public:
-        bool operator()(SV sv1, SV sv2) const
+        // With the name's hash computed beforehand
+        static size_t Combine(size_t asset, size_t name_hash)
         {
-            return sv1.size() == sv2.size() && 
-                CompareEqualLength(sv1, sv2);
+            return name_hash ^ (asset * 0x9e'37'79'b9);
         }
     };
-    
-    using File = std::filesystem::directory_entry;
-    using AssetsDict = std::unordered_map<std::string_view, size_t, 
+
+    struct ChunkKeyEquals
+    {
+        bool operator()(const ChunkKey& key1, const ChunkKey& key2) const
+        {
+            return key1.asset == key2.asset && 
+                CN_Equals<std::string_view>{}(key1.name, key2.name);
+        }
+    };
+
+    using AssetsDict = FlatHashMap<std::string_view, size_t, 
         CN_Hasher<std::string_view>, CN_Equals<std::string_view>>;
-    using ChunksDict = std::unordered_map<size_t, 
-        std::unordered_map<std::string_view, size_t, 
-            CN_Hasher<std::string_view>, 
-            CN_Equals<std::string_view>>>;
-    using ChunkNames = std::unordered_map<std::string_view, 
-        std::pair<size_t, size_t>, CN_Hasher<std::string_view>, 
-        CN_Equals<std::string_view>>;
+    using ChunksDict = FlatHashMap<ChunkKey, size_t, 
+        ChunkKeyHasher, ChunkKeyEquals>;
     
     // Sorted vector of acceptable formats
     const static std::vector<std::string_view> formats;
 
+    // Exported data is buffered and written out in pieces of this size
+    const static size_t export_block_size = 1 << 20;
+
+    // Assets are exported to asset.dat in blocks of this many
+    constexpr static size_t export_block_assets = 1 << 12;
+
+    /* Bumped whenever models are parsed differently or records 
+    of the parse cache change their layout */
+    constexpr static uint64_t parse_cache_version = 1;
+
+    // Bumped whenever the layout of index snapshots changes
+    constexpr static uint32_t snapshot_version = 2;
+
+    // Opening files is left to at most this many threads
+    constexpr static unsigned int max_io_threads = 8;
+
+    /* Models are read ahead only this far, which covers the headers 
+    of their first chunks, as the parser skips over chunk data */
+    constexpr static size_t model_read_ahead = 1 << 16;
+
     const std::string root_path_;
+    unsigned int n_threads_ = 1; // worker threads parsing files and decoding .dat records
+    unsigned int n_reads_ = 0; // files mapped ahead of parsing
+    bool content_hashing_ = false; // are files' contents checked for changes?
+    bool lazy_import_ = false; // are .dat records decoded only when needed?
+    std::unique_ptr<ParseCacheBackend> parse_cache_; // parsed models by contents
+
+    // Asset files found in the directory tree
+    std::vector<FileRecord> manifest_;
     
     size_t n_assets_ = 0; // max total of assets
     size_t n_dat_assets_ = 0; // total of existing assets
@@ -86,31 +255,98 @@ private:
     // Total of chunk inputs/dependencies
     size_t n_inputs_ = 0;
 
+    /* The source .dat file, which records imported lazily point 
+    into, so that it is kept until the end */
+    MappedFile dat_map_;
+
     // Asset collections and dictionaries
-    std::vector<Asset> assets_; // all assets
+    std::vector<AssetRecord> assets_; // all assets
+    ChunkStore chunks_; // chunks of all assets
     AssetsDict assets_dict_; // index of all assets
-    ChunksDict chunks_dict_; // index of all chunks sectioned by assets
-    ChunkNames chunk_names_dict_; // index of all chunks' names
+    ChunksDict chunks_dict_; // index of all chunks by assets
+    std::vector<bool> chunk_names_; // flags of chunks' names by their classes
+
+    // Records of assets imported lazily
+    std::vector<DatRecord> dat_records_;
+    std::vector<DatRange> dat_inputs_;
+    size_t n_lazy_assets_ = 0; // assets whose records are yet to be decoded
         
 private:
-    bool IsValidFile(const File& file);
+    bool IsValidFile(const File& file, FileRecord::Type& type);
 
-    void CountNewFiles();
-    uint64_t ReadDatHeader(std::ifstream& ifs);
+    void ScanFiles();
+    bool IsUpToDate(const FileRecord& record) const;
+    std::string_view SourcePath(const FileRecord& record) const;
+    const AssetRecord* FindSource(const FileRecord& record) const;
+    static void MapFile(const FileRecord& record, ParsedFile& parsed);
+    static uint64_t ParseCacheKey(const ParsedFile& parsed);
+    static void RestoreFile(const FileRecord& record, ParsedFile& parsed, 
+        augmented::ifstream& ifs, ParseCacheBackend& cache);
+    static void StoreFile(ParsedFile& parsed, 
+        augmented::ifstream& ifs, ParseCacheBackend& cache);
+    static void ParseFile(const FileRecord& record, ParsedFile& parsed, 
+        ParseCacheBackend* cache);
+    uint64_t ReadDatHeader(BinaryReader& reader);
+    uint64_t ReadIdxHeader(BinaryReader& reader);
+    uint64_t DatTime() const; // the last write time of asset.dat, 0 if none
+    static uint64_t DictFingerprint(); // of how names are hashed and laid out
 
     template <typename Invalidator, typename Decrementor>
     void ProcessInputs(Invalidator&& inv, 
     Decrementor&& dec);
 
-    void ImportExistAssetData(augmented::ifstream& ifs);
-    void ImportExistInputData(augmented::ifstream& ifs);
+    static void SkipDatChunks(BinaryReader& reader);
+    static bool SkipCanonicalDatChunks(BinaryReader& reader);
+    static bool SkipToDatChunk(DatRecord& dat, std::string_view chunk_name);
+    static void SkipDatAsset(BinaryReader& reader);
+    static void SkipDatInputs(BinaryReader& reader);
+    static void DecodeDatAsset(BinaryReader& reader, DatBlock& block);
+    static void DecodeDatInputs(BinaryReader& reader, DatBlock& block);
+
+    template <typename Skip, typename Decode, typename Merge>
+    void DecodeDatBlocks(BinaryReader& reader, size_t n_records, 
+        Skip&& skip, Decode&& decode, Merge&& merge);
+
+    void MergeDatChunks(size_t i, const DatChunk* chunks, uint32_t n_chunks);
+    void MergeDatAssets(const DatBlock& block);
+    void MergeDatInputs(const DatBlock& block);
+    void IndexDatAsset(BinaryReader& reader);
+    void ImportExistAssetData(BinaryReader& reader);
+    void ImportExistInputData(BinaryReader& reader);
+    void IndexExistInputData(BinaryReader& reader);
+    void DecodeAsset(size_t i);
+    void DecodeAssets();
+    void ImportExistSourceData(uint64_t dat_size);
+    bool ImportSnapshot(uint64_t dat_size, uint64_t dat_time);
+
+    void SetChunkName(uint32_t name_id, bool is_set);
+    bool IsChunkName(uint32_t name_id) const;
+    void SetDatChunkNames(const DatRecord& dat, bool is_set);
+    bool AreDatInputsResolved(const DatRecord& dat);
 
     void AddAsset(Asset&& asset, size_t i);
     void AddAsset(Asset&& asset);
+    void SetSource(size_t i, const FileRecord& file, uint64_t content_hash);
     
-    void WriteDatHeader(std::ofstream& ofs) const;
-    void ExportAssetData(std::ofstream& ofs) const;
-    void ExportInputData(std::ofstream& ofs) const;
+    // Sizes of records as they are exported
+    size_t AssetRecordSize(const AssetRecord& asset) const;
+    size_t InputRecordsSize(const AssetRecord& asset) const;
+
+    void WriteDatHeader(BinaryWriter& writer) const;
+    void WriteAssetRecord(BinaryWriter& writer, const AssetRecord& asset) const;
+    size_t WriteInputRecords(BinaryWriter& writer, const AssetRecord& asset) const;
+
+    template <typename Export, typename Done>
+    void ExportBlocks(std::vector<ExportBlock>& blocks, 
+        Export&& export_block, Done&& done) const;
+
+    static void WriteOut(const OutputFile& file, BinaryWriter& writer, 
+        uint64_t& offset);
+    uint64_t LayOutData(std::vector<ExportBlock>& blocks) const;
+    void ExportAssetData(const OutputFile& file, std::vector<ExportBlock>& blocks) const;
+    void ExportInputData(const OutputFile& file, std::vector<ExportBlock>& blocks) const;
+    void ExportSourceData(uint64_t dat_size) const;
+    void ExportSnapshot(uint64_t dat_size, uint64_t dat_time) const;
 
 public:
     template <typename S>
@@ -121,11 +357,32 @@ public:
 
     ~AssetCacher() = default;
 
+    // 0 stands for as many threads as the hardware supports
+    void SetThreads(unsigned int n_threads);
+
+    // 0 stands for four files per parsing thread
+    void SetReadsInFlight(unsigned int n_reads);
+
+    /* Files known to be the sources of cached assets are then
+    re-read in incremental mode and are updated if their contents
+    differ, whatever their times */
+    void SetContentHashing(bool is_enabled);
+
+    /* Models are looked up in the cache by their contents before 
+    they are parsed, and those parsed are added to it; nullptr 
+    turns the cache off */
+    void SetParseCache(std::unique_ptr<ParseCacheBackend> cache);
+
+    /* Only names and boundaries of records are read from the 
+    source .dat file, the rest being decoded for assets which 
+    need it.  Untouched records are copied over on export. */
+    void SetLazyImport(bool is_enabled);
+
     void ImportExistData();
     void ImportNewData();
     void ValidateInputs();
     void FilterInputs();
-    void ExportData() const;
+    void ExportData();
 };
 
 template <typename Invalidator, typename Decrementor>
@@ -135,37 +392,55 @@ void AssetCacher::ProcessInputs(Invalidator &&inv,
     std::cout << "**Validating inputs\n";
 
     std::ofstream warnings;
-    ProgressBar bar(n_inputs_);
+    ProgressBar bar(assets_.size());
     size_t n_missing_inputs = 0;
 
-    for (Asset& asset : assets_)
+    for (size_t a = 0; a < assets_.size(); ++a)
     {
-        for (Asset::Chunk& chunk : asset.chunks)
+        /* Inputs of records imported lazily are looked up as they 
+        are, and only records with missing ones are decoded to be 
+        reported and filtered like the others */
+        if (assets_[a].dat_record != AssetRecord::no_record)
+        {
+            if (AreDatInputsResolved(dat_records_[assets_[a].dat_record]))
+            {
+                ++bar;
+                continue;
+            }
+            DecodeAsset(a);
+        }
+
+        const AssetRecord& asset = assets_[a];
+        for (uint32_t c = asset.first_chunk; 
+            c < asset.first_chunk + asset.n_chunks; ++c)
         {
-            size_t n_valid_inputs = chunk.inputs.size();
+            uint32_t begin = chunks_.input_begins[c];
+            uint32_t end = begin + chunks_.input_counts[c];
+            size_t n_valid_inputs = chunks_.input_counts[c];
 
-            for (size_t i = 0; i < chunk.inputs.size(); ++i)
+            for (uint32_t i = begin; i < end; ++i)
             {
-                if (chunk_names_dict_.find(chunk.inputs[i]) == 
-                    chunk_names_dict_.end())
+                if (!IsChunkName(chunks_.inputs[i]))
                 {
                     if (warnings.is_open()) warnings << '\n';
                     else warnings.open(root_path_ + "warnings.log");
                     
-                    inv(chunk, i);
+                    inv(i);
                     n_valid_inputs = dec(n_valid_inputs);
 
                     warnings << std::format("Chunk {0} in asset {1} has "
                         "an unresolved dependency: {2};", 
-                        chunk.name, asset.name, chunk.inputs[i]);
+                        Asset::symbols.Name(chunks_.name_ids[c]), 
+                        Asset::symbols.Name(asset.name_id), 
+                        Asset::symbols.Name(chunks_.inputs[i]));
                     ++n_missing_inputs;
                 }
             }
             
-            if (chunk.inputs.size() && 
+            if (begin != end && 
                 !n_valid_inputs) --n_inputs_;
-            ++bar;
         }
+        ++bar;
     }
     std::cout << '\n';
 
@@ -178,5 +453,6 @@ AssetCacher::AssetCacher(S&& s) :
 {
     std::error_code ec;
     std::filesystem::remove(root_path_ + "warnings.log", ec);
-    CountNewFiles();
+    ScanFiles();
+    SetThreads(0);
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 #include "container_utils.h"
+#include "binary_io.h"
+#include "mapped_file.h"
 #include <fstream>
 #include <vector>
 
@@ -14,6 +16,10 @@ namespace augmented
         std::basic_string_view<T> file_ext_{};
         std::basic_ifstream<T> ifs_{};
 
+        // The mapped mode: the whole file and a cursor within it
+        MappedFile map_{};
+        BinaryReader reader_{};
+
     private:
         void SetStem();
         void SetExtension();
@@ -30,6 +36,23 @@ namespace augmented
             const Container& formats = {},
             bool binary_search = false);
 
+        // Maps the file into memory instead of opening a stream
+        template <typename S>
+        void Map(S&&);
+
+        // Takes over a file which has already been mapped
+        template <typename S>
+        void Map(S&&, MappedFile&&);
+
+        bool IsOpen() const { return ifs_.is_open() || map_.IsOpen(); }
+        bool IsMapped() const { return map_.IsOpen(); }
+
+        // Reading in the mapped mode
+        BinaryReader& Reader() { return reader_; }
+
+        static std::basic_string_view<T> Stem(std::basic_string_view<T> path);
+        static std::basic_string_view<T> Extension(std::basic_string_view<T> path);
+
         std::basic_ifstream<T>& FS() { return ifs_; }
         const std::basic_string<T>& FilePath() const { return file_path_; }
         const std::basic_string_view<T>& FileStem() const { return file_stem_; }
@@ -37,23 +60,35 @@ namespace augmented
     };
 
     template <typename T>
-    void basic_ifstream<T>::SetStem()
+    std::basic_string_view<T> 
+    basic_ifstream<T>::Stem(std::basic_string_view<T> path)
     {
-        size_t pos = file_path_.find_last_of('\\');
+        size_t pos = path.find_last_of('\\');
         pos = (pos == std::string::npos) ? 0 : pos;
 
-        file_stem_ = file_path_;
-        file_stem_ = file_stem_.substr(pos + 1);
+        return path.substr(pos + 1);
     }
 
     template <typename T>
-    void basic_ifstream<T>::SetExtension()
+    std::basic_string_view<T> 
+    basic_ifstream<T>::Extension(std::basic_string_view<T> path)
     {
-        size_t pos = file_path_.find_last_of('.');
+        size_t pos = path.find_last_of('.');
         pos = (pos == std::string::npos) ? 0 : pos;
 
-        file_ext_ = file_path_;
-        file_ext_ = file_ext_.substr(pos);
+        return path.substr(pos);
+    }
+
+    template <typename T>
+    void basic_ifstream<T>::SetStem()
+    {
+        file_stem_ = Stem(file_path_);
+    }
+
+    template <typename T>
+    void basic_ifstream<T>::SetExtension()
+    {
+        file_ext_ = Extension(file_path_);
     }
 
     template <typename T>
@@ -104,6 +139,32 @@ namespace augmented
         }
     }
 
+    template <typename T>
+    template <typename S>
+    void basic_ifstream<T>::Map(S&& s)
+    {
+        file_path_ = { std::forward<S>(s) };
+        SetStem();
+        SetExtension();
+
+        ifs_.close();
+        map_.Open(file_path_);
+        reader_ = { map_.Data(), map_.Size() };
+    }
+
+    template <typename T>
+    template <typename S>
+    void basic_ifstream<T>::Map(S&& s, MappedFile&& map)
+    {
+        file_path_ = { std::forward<S>(s) };
+        SetStem();
+        SetExtension();
+
+        ifs_.close();
+        map_ = std::move(map);
+        reader_ = { map_.Data(), map_.Size() };
+    }
+
     typedef basic_ifstream<char> ifstream;
     typedef basic_ifstream<wchar_t> wifstream;
 }
\ No newline at end of file
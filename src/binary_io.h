@@ -1,58 +1,148 @@
 #pragma once
 #include <cstdint>
-#include <fstream>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
-template <typename T>
-T ReadPrimitive(std::ifstream& ifs)
+// Sequential bounds-checked reading from a contiguous range of bytes
+class BinaryReader
 {
-    T out;
-    ifs.read((char*)&out, sizeof(out));
-    return out;
-}
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    size_t pos_ = 0;
 
-template <typename T>
-void WritePrimitive(std::ofstream& ofs, T t)
-{
-    ofs.write((char*)&t, sizeof(t));
-}
+public:
+    BinaryReader() = default;
+    BinaryReader(const char* data, size_t size) :
+        data_{data},
+        size_{size}
+    {}
 
-template <typename T>
-std::string ReadString(std::ifstream& ifs)
-{
-    T size = ReadPrimitive<T>(ifs);
-    std::vector<char> buffer(size);
-    ifs.read(buffer.data(), size);
+    const char* Data() const { return data_; }
+    size_t Size() const { return size_; }
+    size_t Tell() const { return pos_; }
+    bool AtEnd() const { return pos_ >= size_; }
 
-    return { buffer.begin(), buffer.end() };
-}
+    void Seek(size_t pos) { pos_ = pos; }
+    void Skip(size_t n) { pos_ += n; }
 
-inline std::string ReadShortString(std::ifstream& ifs)
-{
-    return ReadString<uint8_t>(ifs);
-}
+    // Returns a pointer to the next n bytes and moves past them
+    const char* Take(size_t n)
+    {
+        if (pos_ > size_ || n > size_ - pos_)
+        {
+            throw std::out_of_range("Unexpected end of file: ");
+        }
 
-template <typename T>
-void WriteString(std::ofstream& ofs, const std::string& string)
-{
-    T size = (T)string.size();
-    ofs.write((char*)&size, sizeof(size));
-    ofs.write(string.data(), size);
-}
+        const char* out = data_ + pos_;
+        pos_ += n;
+        return out;
+    }
 
-inline void WriteShortString(std::ofstream& ofs, const std::string& string)
-{
-    WriteString<uint8_t>(ofs, string);
-}
+    template <typename T>
+    T Read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        T out;
+        std::memcpy(&out, Take(sizeof(out)), sizeof(out));
+        return out;
+    }
+
+    // n values of type T stored back to back
+    template <typename T>
+    void ReadArray(T* out, size_t n)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        if (n > size_ / sizeof(T)) throw std::out_of_range("Unexpected end of file: ");
+        std::memcpy(out, Take(n * sizeof(T)), n * sizeof(T));
+    }
+
+    // A string prefixed with its size of type T
+    template <typename T>
+    std::string_view ReadString()
+    {
+        T size = Read<T>();
+        return { Take(size), size };
+    }
+
+    std::string_view ReadShortString()
+    {
+        return ReadString<uint8_t>();
+    }
+
+    // A zero-padded string in a field of a fixed size
+    std::string_view ReadFixedSizeString(size_t size)
+    {
+        const char* from = Take(size);
+        const char* to = (const char*)std::memchr(from, '\0', size);
 
-inline std::string ReadFixedSizeString(std::ifstream& ifs, 
-    unsigned int size)
+        return { from, to ? (size_t)(to - from) : size };
+    }
+};
+
+// Sequential writing into a growable buffer
+class BinaryWriter
 {
-    std::vector<char> buffer(size);
-    ifs.read(buffer.data(), size);
-
-    std::vector<char>::iterator to = buffer.begin();
-    while (to != buffer.end() && *to != '\0') ++to;
-    
-    return { buffer.begin(), to };
-}
\ No newline at end of file
+private:
+    std::vector<char> buffer_;
+
+public:
+    BinaryWriter() = default;
+
+    const char* Data() const { return buffer_.data(); }
+    size_t Size() const { return buffer_.size(); }
+
+    void Reserve(size_t size) { buffer_.reserve(size); }
+    void Clear() { buffer_.clear(); }
+
+    // Writes the buffered data out and empties the buffer
+    void Flush(std::ostream& os)
+    {
+        os.write(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+
+    void Write(const char* data, size_t size)
+    {
+        buffer_.insert(buffer_.end(), data, data + size);
+    }
+
+    template <typename T>
+    void Write(T t)
+    {
+        Write((const char*)&t, sizeof(t));
+    }
+
+    template <typename T>
+    void WriteArray(const T* data, size_t n)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        Write((const char*)data, n * sizeof(T));
+    }
+
+    // A string prefixed with its size of type T
+    template <typename T>
+    void WriteString(std::string_view string)
+    {
+        Write<T>((T)string.size());
+        Write(string.data(), (T)string.size());
+    }
+
+    void WriteShortString(std::string_view string)
+    {
+        WriteString<uint8_t>(string);
+    }
+
+    // The number of bytes WriteShortString writes for the string
+    static size_t ShortStringSize(std::string_view string)
+    {
+        return sizeof(uint8_t) + (uint8_t)string.size();
+    }
+};
\ No newline at end of file
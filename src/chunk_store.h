@@ -0,0 +1,82 @@
+#pragma once
+#include "w3d.h"
+
+#include <cstdint>
+#include <vector>
+
+/* Chunks of all cached assets kept column by column, a chunk being
+an index into the columns.  Inputs of all chunks share one array,
+in which each chunk owns a contiguous range. */
+struct ChunkStore
+{
+    std::vector<ChunkType> types;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> sizes;
+    std::vector<uint32_t> name_ids; // ids in the symbol table
+
+    // Ranges of chunks' inputs
+    std::vector<uint32_t> input_begins;
+    std::vector<uint32_t> input_counts;
+
+    std::vector<uint32_t> inputs; // ids of inputs' names
+    std::vector<bool> validities; // flags of inputs
+
+    size_t Size() const { return types.size(); }
+
+    void Reserve(size_t n_chunks)
+    {
+        types.reserve(n_chunks);
+        offsets.reserve(n_chunks);
+        sizes.reserve(n_chunks);
+        name_ids.reserve(n_chunks);
+        input_begins.reserve(n_chunks);
+        input_counts.reserve(n_chunks);
+    }
+
+    // Appends a parsed chunk along with its inputs
+    uint32_t Append(const Asset::Chunk& chunk)
+    {
+        types.push_back(chunk.type);
+        offsets.push_back(chunk.offset);
+        sizes.push_back(chunk.size);
+        name_ids.push_back(chunk.name_id);
+
+        input_begins.push_back((uint32_t)inputs.size());
+        input_counts.push_back((uint32_t)chunk.inputs.size());
+        inputs.insert(inputs.end(), chunk.inputs.begin(), chunk.inputs.end());
+        validities.resize(inputs.size(), true);
+
+        return (uint32_t)(types.size() - 1);
+    }
+
+    // Appends a chunk without inputs
+    uint32_t Append(ChunkType type, uint32_t offset, uint32_t size, 
+        uint32_t name_id)
+    {
+        types.push_back(type);
+        offsets.push_back(offset);
+        sizes.push_back(size);
+        name_ids.push_back(name_id);
+
+        input_begins.push_back((uint32_t)inputs.size());
+        input_counts.push_back(0);
+
+        return (uint32_t)(types.size() - 1);
+    }
+
+    /* Moves the chunk's range of inputs to the end of the array,
+    so that new inputs can be added to it */
+    void ClearInputs(uint32_t chunk)
+    {
+        input_begins[chunk] = (uint32_t)inputs.size();
+        input_counts[chunk] = 0;
+    }
+
+    // The chunk's range must be the last one in the array
+    void AddInput(uint32_t chunk, uint32_t input)
+    {
+        inputs.push_back(input);
+        validities.push_back(true);
+        ++input_counts[chunk];
+    }
+};
\ No newline at end of file
@@ -22,7 +22,12 @@ struct Config
     
     bool show_settings = true;
     bool incremental = false;
+    bool content_hashing = false;
+    std::basic_string<T> parse_cache{}; // the directory, empty if there is none
+    bool lazy_import = false;
     InputPolicy input_policy = InputPolicy::Informative;
+    unsigned int n_threads = 0; // 0 stands for all hardware threads
+    unsigned int n_reads = 0; // 0 stands for four files per thread
 
 private:
     template <typename Str>
@@ -152,6 +157,24 @@ void Config<T>::Read(S&& s)
         incremental = pos->second;
     }
 
+    pos = json_config.find("Content hashing"s);
+    if (pos != json_config.end())
+    {
+        content_hashing = pos->second;
+    }
+
+    pos = json_config.find("Lazy import"s);
+    if (pos != json_config.end())
+    {
+        lazy_import = pos->second;
+    }
+
+    pos = json_config.find("Parse cache"s);
+    if (pos != json_config.end() && pos->second.IsString())
+    {
+        parse_cache = pos->second.AsString();
+    }
+
     pos = json_config.find("Show settings"s);
     if (pos != json_config.end())
     {
@@ -168,6 +191,20 @@ void Config<T>::Read(S&& s)
         else if (policy == "informative"sv) input_policy = InputPolicy::Informative;
         else if (policy == "pedantic"sv) input_policy = InputPolicy::Pedantic;
     }
+
+    pos = json_config.find("Threads"s);
+    if (pos != json_config.end() && pos->second.IsInt())
+    {
+        int threads = pos->second;
+        n_threads = (threads > 0) ? threads : 0;
+    }
+
+    pos = json_config.find("Reads in flight"s);
+    if (pos != json_config.end() && pos->second.IsInt())
+    {
+        int reads = pos->second;
+        n_reads = (reads > 0) ? reads : 0;
+    }
 }
 
 template <typename T>
@@ -187,6 +224,9 @@ void Config<T>::Save(S&& s)
     json::Dict<T>& json_config = json_doc.GetRoot().AsMap();
 
     json_config["Incremental"s] = incremental;
+    json_config["Content hashing"s] = content_hashing;
+    json_config["Parse cache"s] = parse_cache;
+    json_config["Lazy import"s] = lazy_import;
     json_config["Show settings"s] = show_settings;
 
     switch (input_policy)
@@ -207,6 +247,9 @@ void Config<T>::Save(S&& s)
         break;
     }
 
+    json_config["Threads"s] = (int)n_threads;
+    json_config["Reads in flight"s] = (int)n_reads;
+
     std::basic_ofstream<T> ofs(std::forward<S>(s));
     json_doc.Print(ofs);
 }
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/* A fast non-cryptographic hash of file contents (XXH64), which tells
+whether a file has changed regardless of its time stamps.  Unlike
+NameHash it is stored in files, so it is the same on every platform. */
+namespace content_hash
+{
+    constexpr uint64_t prime1 = 0x9e'37'79'b1'85'eb'ca'87;
+    constexpr uint64_t prime2 = 0xc2'b2'ae'3d'27'd4'eb'4f;
+    constexpr uint64_t prime3 = 0x16'56'67'b1'9e'37'79'f9;
+    constexpr uint64_t prime4 = 0x85'eb'ca'77'c2'b2'ae'63;
+    constexpr uint64_t prime5 = 0x27'd4'eb'2f'16'56'67'c5;
+
+    inline uint64_t Rotate(uint64_t word, int n)
+    {
+        return (word << n) | (word >> (64 - n));
+    }
+
+    inline uint64_t Load64(const char* data)
+    {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        return word;
+    }
+
+    inline uint32_t Load32(const char* data)
+    {
+        uint32_t word;
+        std::memcpy(&word, data, 4);
+        return word;
+    }
+
+    inline uint64_t Round(uint64_t acc, uint64_t word)
+    {
+        acc += word * prime2;
+        return Rotate(acc, 31) * prime1;
+    }
+
+    inline uint64_t Merge(uint64_t hash, uint64_t acc)
+    {
+        hash ^= Round(0, acc);
+        return hash * prime1 + prime4;
+    }
+}
+
+// Words are read as little-endian, which is the case on all targets
+inline uint64_t ContentHash(const char* data, size_t size)
+{
+    using namespace content_hash;
+
+    const char* end = data + size;
+    uint64_t hash;
+
+    // Four independent lanes keep the multipliers busy
+    if (size >= 32)
+    {
+        uint64_t acc[4] = { prime1 + prime2, prime2, 0, 0 - prime1 };
+
+        for (; end - data >= 32; data += 32)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                acc[i] = Round(acc[i], Load64(data + 8 * i));
+            }
+        }
+
+        hash = Rotate(acc[0], 1) + Rotate(acc[1], 7) +
+            Rotate(acc[2], 12) + Rotate(acc[3], 18);
+        for (uint64_t a : acc) hash = Merge(hash, a);
+    }
+    else
+    {
+        hash = prime5;
+    }
+
+    hash += size;
+
+    for (; end - data >= 8; data += 8)
+    {
+        hash ^= Round(0, Load64(data));
+        hash = Rotate(hash, 27) * prime1 + prime4;
+    }
+
+    if (end - data >= 4)
+    {
+        hash ^= Load32(data) * prime1;
+        hash = Rotate(hash, 23) * prime2 + prime3;
+        data += 4;
+    }
+
+    for (; data < end; ++data)
+    {
+        hash ^= (uint8_t)*data * prime5;
+        hash = Rotate(hash, 11) * prime1;
+    }
+
+    // Avalanche
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
\ No newline at end of file
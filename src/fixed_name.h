@@ -0,0 +1,74 @@
+#pragma once
+#include "name_hash.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+/* A name stored inline in a buffer of a fixed capacity, so that
+building it never touches the heap.  Its case-neutral hash (see
+name_hash.h) is computed once, when first asked for, and kept
+until the name changes. */
+template <size_t Capacity>
+class FixedName
+{
+    static_assert(Capacity <= 0xff, "Names are limited to short strings");
+
+private:
+    char data_[Capacity]{};
+    uint8_t size_ = 0;
+
+    mutable size_t hash_ = 0;
+    mutable bool is_hashed_ = false;
+
+public:
+    FixedName() = default;
+    FixedName(std::string_view sv) { *this += sv; }
+
+    FixedName& operator=(std::string_view sv)
+    {
+        size_ = 0;
+        return *this += sv;
+    }
+
+    FixedName& operator+=(std::string_view sv)
+    {
+        if (sv.size() > Capacity - size_)
+        {
+            throw std::length_error("The name is too long!");
+        }
+
+        if (sv.size()) std::memcpy(data_ + size_, sv.data(), sv.size());
+        size_ += (uint8_t)sv.size();
+        is_hashed_ = false;
+
+        return *this;
+    }
+
+    FixedName& operator+=(char c)
+    {
+        return *this += std::string_view(&c, 1);
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return !size_; }
+
+    std::string_view View() const { return { data_, size_ }; }
+    operator std::string_view() const { return View(); }
+
+    size_t Hash() const
+    {
+        if (!is_hashed_)
+        {
+            hash_ = NameHash(View());
+            is_hashed_ = true;
+        }
+
+        return hash_;
+    }
+
+    bool operator==(std::string_view sv) const { return View() == sv; }
+};
\ No newline at end of file
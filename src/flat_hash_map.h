@@ -0,0 +1,390 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/* An open-addressing hash map in the manner of Swiss tables.
+Each slot has a control byte, which is either empty, deleted or
+holds 7 bits of the key's hash.  Control bytes are probed in
+groups of 8 at once, so that keys are compared only when those
+bits match.  Full hashes are stored alongside the entries, which
+spares rehashing keys when the table grows.  Unlike
+std::unordered_map, there is one allocation per array rather
+than one per entry.  Keys and values must be default-constructible. */
+template <typename Key, typename Value, typename Hasher, typename Equals>
+class FlatHashMap
+{
+public:
+    using value_type = std::pair<Key, Value>;
+
+private:
+    using Group = uint64_t;
+
+    constexpr static size_t group_width = sizeof(Group);
+
+    constexpr static int8_t ctrl_empty = -128; // 0b10000000
+    constexpr static int8_t ctrl_deleted = -2; // 0b11111110
+
+    constexpr static Group lsbs = 0x01'01'01'01'01'01'01'01;
+    constexpr static Group msbs = 0x80'80'80'80'80'80'80'80;
+
+    std::vector<int8_t> ctrl_;
+    std::vector<size_t> hashes_;
+    std::vector<value_type> slots_;
+
+    size_t size_ = 0;
+    size_t growth_left_ = 0; // insertions left before a rehash
+
+    Hasher hasher_{};
+    Equals equals_{};
+
+private:
+    // Spreads the entropy of weak hashes over all bits
+    static size_t Mix(size_t hash)
+    {
+        uint64_t out = hash;
+        out ^= out >> 33;
+        out *= 0xff'51'af'd7'ed'55'8c'cd;
+        out ^= out >> 33;
+        return (size_t)out;
+    }
+
+    static int8_t H2(size_t hash) { return (int8_t)(Mix(hash) & 0x7f); }
+    size_t H1(size_t hash) const { return (Mix(hash) >> 7) & (NGroups() - 1); }
+
+    size_t NGroups() const { return ctrl_.size() / group_width; }
+
+    Group LoadGroup(size_t group) const
+    {
+        Group out;
+        std::memcpy(&out, ctrl_.data() + group * group_width, sizeof(out));
+        return out;
+    }
+
+    // Bit masks with the top bit of each matching byte set
+    static Group MatchH2(Group group, int8_t h2)
+    {
+        /* False positives are possible, but they are weeded
+        out by comparing full hashes anyway. */
+        Group x = group ^ (lsbs * (uint8_t)h2);
+        return (x - lsbs) & ~x & msbs;
+    }
+
+    static Group MatchEmpty(Group group)
+    {
+        return group & ~(group << 6) & msbs;
+    }
+
+    static Group MatchEmptyOrDeleted(Group group)
+    {
+        return group & ~(group << 7) & msbs;
+    }
+
+    static size_t LowestByte(Group mask)
+    {
+        size_t i = 0;
+        while (!(mask & 0x80)) { mask >>= 8; ++i; }
+        return i;
+    }
+
+    // Index of the slot with the key, ctrl_.size() if there is none
+    template <typename K>
+    size_t FindSlot(const K& key, size_t hash) const
+    {
+        if (ctrl_.empty()) return 0;
+
+        int8_t h2 = H2(hash);
+        size_t group = H1(hash);
+
+        /* Triangular probing visits every group once, as
+        the number of groups is a power of two. */
+        for (size_t step = 1; ; group = (group + step++) & (NGroups() - 1))
+        {
+            Group ctrl = LoadGroup(group);
+
+            for (Group match = MatchH2(ctrl, h2); match; match &= match - 1)
+            {
+                size_t i = group * group_width + LowestByte(match);
+                if (hashes_[i] == hash && equals_(slots_[i].first, key)) return i;
+            }
+
+            if (MatchEmpty(ctrl) || step > NGroups()) return ctrl_.size();
+        }
+    }
+
+    // The first slot available for a new entry with the hash
+    size_t FindFreeSlot(size_t hash) const
+    {
+        size_t group = H1(hash);
+
+        for (size_t step = 1; ; group = (group + step++) & (NGroups() - 1))
+        {
+            Group match = MatchEmptyOrDeleted(LoadGroup(group));
+            if (match) return group * group_width + LowestByte(match);
+        }
+    }
+
+    void Rehash(size_t capacity)
+    {
+        std::vector<int8_t> ctrl(capacity, ctrl_empty);
+        std::vector<size_t> hashes(capacity);
+        std::vector<value_type> slots(capacity);
+
+        ctrl.swap(ctrl_);
+        hashes.swap(hashes_);
+        slots.swap(slots_);
+        growth_left_ = capacity - capacity / 8 - size_;
+
+        // Stored hashes are reused, keys are not hashed again
+        for (size_t i = 0; i < ctrl.size(); ++i)
+        {
+            if (ctrl[i] < 0) continue;
+
+            size_t j = FindFreeSlot(hashes[i]);
+            ctrl_[j] = ctrl[i];
+            hashes_[j] = hashes[i];
+            slots_[j] = std::move(slots[i]);
+        }
+    }
+
+    // Keeps the load factor at 7/8 at most
+    static size_t CapacityFor(size_t size)
+    {
+        size_t capacity = group_width;
+        while (capacity - capacity / 8 < size) capacity *= 2;
+        return capacity;
+    }
+
+    template <typename K>
+    size_t Insert(K&& key, size_t hash)
+    {
+        size_t i = FindSlot(key, hash);
+        if (i < ctrl_.size()) return i;
+
+        // Tombstones are dropped when the table is rebuilt
+        if (!growth_left_) Rehash(CapacityFor(2 * (size_ + 1)));
+
+        i = FindFreeSlot(hash);
+        if (ctrl_[i] == ctrl_empty) --growth_left_;
+
+        ctrl_[i] = H2(hash);
+        hashes_[i] = hash;
+        slots_[i] = { Key(std::forward<K>(key)), Value{} };
+        ++size_;
+
+        return i;
+    }
+
+public:
+    template <typename Map, typename V>
+    class Iterator
+    {
+        friend FlatHashMap;
+
+    private:
+        Map* map_ = nullptr;
+        size_t i_ = 0;
+
+        Iterator(Map* map, size_t i) :
+            map_{map},
+            i_{i}
+        {
+            SkipFree();
+        }
+
+        void SkipFree()
+        {
+            while (i_ < map_->ctrl_.size() && map_->ctrl_[i_] < 0) ++i_;
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = V*;
+        using reference = V&;
+
+        Iterator() = default;
+
+        reference operator*() const { return map_->slots_[i_]; }
+        pointer operator->() const { return &map_->slots_[i_]; }
+
+        Iterator& operator++()
+        {
+            ++i_;
+            SkipFree();
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator out = *this;
+            ++*this;
+            return out;
+        }
+
+        bool operator==(const Iterator& other) const { return i_ == other.i_; }
+        bool operator!=(const Iterator& other) const { return i_ != other.i_; }
+    };
+
+    using iterator = Iterator<FlatHashMap, value_type>;
+    using const_iterator = Iterator<const FlatHashMap, const value_type>;
+
+    FlatHashMap() = default;
+
+    size_t size() const { return size_; }
+    bool empty() const { return !size_; }
+
+    iterator begin() { return { this, 0 }; }
+    iterator end() { return { this, ctrl_.size() }; }
+    const_iterator begin() const { return { this, 0 }; }
+    const_iterator end() const { return { this, ctrl_.size() }; }
+
+    void reserve(size_t size)
+    {
+        if (size > size_ + growth_left_) Rehash(CapacityFor(size));
+    }
+
+    void clear()
+    {
+        ctrl_.clear();
+        hashes_.clear();
+        slots_.clear();
+        size_ = growth_left_ = 0;
+    }
+
+    /* The hasher's value of a key.  Lookups may be given it 
+    directly, when it is known in advance. */
+    template <typename K>
+    size_t hash(const K& key) const { return hasher_(key); }
+
+    template <typename K>
+    iterator find(const K& key, size_t hash)
+    {
+        return { this, FindSlot(key, hash) };
+    }
+
+    template <typename K>
+    const_iterator find(const K& key, size_t hash) const
+    {
+        return { this, FindSlot(key, hash) };
+    }
+
+    template <typename K>
+    iterator find(const K& key) { return find(key, hash(key)); }
+
+    template <typename K>
+    const_iterator find(const K& key) const { return find(key, hash(key)); }
+
+    template <typename K>
+    Value& at(const K& key, size_t hash)
+    {
+        size_t i = FindSlot(key, hash);
+        if (i == ctrl_.size()) throw std::out_of_range("FlatHashMap::at");
+        return slots_[i].second;
+    }
+
+    template <typename K>
+    const Value& at(const K& key, size_t hash) const
+    {
+        size_t i = FindSlot(key, hash);
+        if (i == ctrl_.size()) throw std::out_of_range("FlatHashMap::at");
+        return slots_[i].second;
+    }
+
+    template <typename K>
+    Value& at(const K& key) { return at(key, hash(key)); }
+
+    template <typename K>
+    const Value& at(const K& key) const { return at(key, hash(key)); }
+
+    // The same as operator[] with a precomputed hash
+    Value& emplace(const Key& key, size_t hash)
+    {
+        return slots_[Insert(key, hash)].second;
+    }
+
+    Value& operator[](const Key& key) { return emplace(key, hash(key)); }
+
+    template <typename K>
+    size_t erase(const K& key, size_t hash)
+    {
+        size_t i = FindSlot(key, hash);
+        if (i == ctrl_.size()) return 0;
+
+        /* Probing never goes past a group with an empty slot,
+        so such a group needs no tombstone. */
+        size_t group = i / group_width;
+        if (MatchEmpty(LoadGroup(group)))
+        {
+            ctrl_[i] = ctrl_empty;
+            ++growth_left_;
+        }
+        else ctrl_[i] = ctrl_deleted;
+
+        slots_[i] = {};
+        --size_;
+        return 1;
+    }
+
+    template <typename K>
+    size_t erase(const K& key) { return erase(key, hash(key)); }
+
+    /* The layout of the table, which can be saved and restored
+    later on without hashing or probing a single key.  Slots with
+    negative control bytes are free, and a full slot may be given
+    the tombstone's control byte to drop its entry. */
+    constexpr static int8_t tombstone = ctrl_deleted;
+
+    size_t capacity() const { return ctrl_.size(); }
+    size_t growth_left() const { return growth_left_; }
+    const int8_t* controls() const { return ctrl_.data(); }
+    const size_t* hashes() const { return hashes_.data(); }
+    const value_type& slot(size_t i) const { return slots_[i]; }
+
+    /* Restores a saved layout, the entry of each full slot i being
+    made by make_slot(i).  Entries must be those the layout was
+    saved with, or lookups would not find them.  Control bytes 
+    are checked against the hashes, and the growth left is counted 
+    anew from them, as a table too full to probe would make 
+    inserting loop forever. */
+    template <typename Fn>
+    void restore(const int8_t* ctrl, const size_t* hashes,
+        size_t capacity, Fn&& make_slot)
+    {
+        if (capacity % group_width || (capacity & (capacity - 1)))
+        {
+            throw std::invalid_argument("FlatHashMap::restore: ");
+        }
+
+        ctrl_.assign(ctrl, ctrl + capacity);
+        hashes_.assign(hashes, hashes + capacity);
+        slots_.assign(capacity, value_type{});
+        size_ = 0;
+
+        size_t n_used = 0; // full slots and tombstones
+        for (size_t i = 0; i < capacity; ++i)
+        {
+            if (ctrl_[i] == ctrl_empty) continue;
+            ++n_used;
+
+            if (ctrl_[i] == ctrl_deleted) continue;
+            if (ctrl_[i] != H2(hashes_[i]))
+            {
+                throw std::invalid_argument("FlatHashMap::restore: ");
+            }
+
+            slots_[i] = make_slot(i);
+            ++size_;
+        }
+
+        if (n_used > capacity - capacity / 8)
+        {
+            throw std::invalid_argument("FlatHashMap::restore: ");
+        }
+        growth_left_ = capacity - capacity / 8 - n_used;
+    }
+};
\ No newline at end of file
@@ -10,6 +10,15 @@ int main()
     config.Save();
 	
     AssetCacher asset_cacher;
+    asset_cacher.SetThreads(config.n_threads);
+    asset_cacher.SetReadsInFlight(config.n_reads);
+    asset_cacher.SetContentHashing(config.content_hashing);
+    asset_cacher.SetLazyImport(config.lazy_import);
+    if (!config.parse_cache.empty())
+    {
+        asset_cacher.SetParseCache(
+            std::make_unique<LocalParseCache>(config.parse_cache));
+    }
     
     if (config.incremental)
     {
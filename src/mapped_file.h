@@ -0,0 +1,168 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A read-only view of a whole file mapped into memory
+class MappedFile
+{
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool is_open_ = false;
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept { swap(other); }
+    explicit MappedFile(const std::filesystem::path& path) { Open(path); }
+    ~MappedFile() { Close(); }
+
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        MappedFile temp(std::move(other));
+        swap(temp);
+        return *this;
+    }
+
+    void swap(MappedFile& other) noexcept
+    {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(is_open_, other.is_open_);
+    }
+
+    bool Open(const std::filesystem::path& path);
+    void Close();
+
+    // Asks the system to start reading the file's first bytes in the background
+    void WillNeed(size_t size) const;
+
+    bool IsOpen() const { return is_open_; }
+    const char* Data() const { return data_; }
+    size_t Size() const { return size_; }
+};
+
+#ifdef _WIN32
+inline bool MappedFile::Open(const std::filesystem::path& path)
+{
+    Close();
+
+    /* Deleting and renaming are allowed, so that the file can
+    still be replaced while it is mapped. */
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    // Empty files cannot be mapped
+    if (!file_size.QuadPart)
+    {
+        CloseHandle(file);
+        return is_open_ = true;
+    }
+
+    // The view keeps the file alive, so handles are closed right away
+    HANDLE mapping = CreateFileMappingW(file, nullptr,
+        PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) return false;
+
+    data_ = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data_) return false;
+
+    size_ = (size_t)file_size.QuadPart;
+    return is_open_ = true;
+}
+
+inline void MappedFile::Close()
+{
+    if (data_) UnmapViewOfFile(data_);
+
+    data_ = nullptr;
+    size_ = 0;
+    is_open_ = false;
+}
+
+inline void MappedFile::WillNeed(size_t size) const
+{
+    // Not available before Windows 8, where this is a no-op
+#if _WIN32_WINNT >= 0x0602
+    if (!data_) return;
+
+    WIN32_MEMORY_RANGE_ENTRY range{ (void*)data_, std::min(size, size_) };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+}
+#else
+inline bool MappedFile::Open(const std::filesystem::path& path)
+{
+    Close();
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // Empty files cannot be mapped
+    if (!file_stat.st_size)
+    {
+        close(fd);
+        return is_open_ = true;
+    }
+
+    // The mapping keeps the file alive, so it is closed right away
+    void* data = mmap(nullptr, file_stat.st_size,
+        PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+
+    data_ = (const char*)data;
+    size_ = (size_t)file_stat.st_size;
+    return is_open_ = true;
+}
+
+inline void MappedFile::Close()
+{
+    if (data_) munmap((void*)data_, size_);
+
+    data_ = nullptr;
+    size_ = 0;
+    is_open_ = false;
+}
+
+inline void MappedFile::WillNeed(size_t size) const
+{
+    if (data_) posix_madvise((void*)data_, std::min(size, size_), POSIX_MADV_WILLNEED);
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,135 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define NAME_HASH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define NAME_HASH_AVX2
+#include <immintrin.h>
+#endif
+
+/* Case-insensitive hashing and comparison of asset and chunk names.
+Only ASCII letters are folded, so names are treated bytewise without
+any locale calls.  Names are folded 8 bytes at a time, or 16/32 when
+SSE2/AVX2 is available, and every path yields the same hash. */
+namespace name_hash
+{
+    constexpr uint64_t lsbs = 0x01'01'01'01'01'01'01'01;
+    constexpr uint64_t msbs = 0x80'80'80'80'80'80'80'80;
+    constexpr uint64_t prime = 0x9e'37'79'b9'7f'4a'7c'15;
+
+    // Lowers the case of ASCII letters in a word
+    inline uint64_t Fold(uint64_t word)
+    {
+        uint64_t heptets = word & ~msbs;
+        uint64_t from_a = heptets + (0x80 - 'A') * lsbs;
+        uint64_t past_z = heptets + (0x80 - 'Z' - 1) * lsbs;
+
+        uint64_t is_upper = from_a & ~past_z & ~word & msbs;
+        return word | (is_upper >> 2);
+    }
+
+    inline uint64_t Mix(uint64_t hash, uint64_t word)
+    {
+        hash = (hash ^ word) * prime;
+        return hash ^ (hash >> 29);
+    }
+
+    inline uint64_t Load(const char* data, size_t size)
+    {
+        uint64_t word = 0;
+        std::memcpy(&word, data, size);
+        return word;
+    }
+
+#ifdef NAME_HASH_SSE2
+    inline __m128i Fold(__m128i block)
+    {
+        // Signed comparisons leave bytes above 0x7f as they are
+        __m128i from_a = _mm_cmpgt_epi8(block, _mm_set1_epi8('A' - 1));
+        __m128i past_z = _mm_cmpgt_epi8(block, _mm_set1_epi8('Z'));
+
+        __m128i is_upper = _mm_andnot_si128(past_z, from_a);
+        return _mm_or_si128(block, _mm_and_si128(is_upper, _mm_set1_epi8(0x20)));
+    }
+#endif
+
+#ifdef NAME_HASH_AVX2
+    inline __m256i Fold(__m256i block)
+    {
+        __m256i from_a = _mm256_cmpgt_epi8(block, _mm256_set1_epi8('A' - 1));
+        __m256i past_z = _mm256_cmpgt_epi8(block, _mm256_set1_epi8('Z'));
+
+        __m256i is_upper = _mm256_andnot_si256(past_z, from_a);
+        return _mm256_or_si256(block, _mm256_and_si256(is_upper, _mm256_set1_epi8(0x20)));
+    }
+#endif
+}
+
+inline size_t NameHash(std::string_view name)
+{
+    using namespace name_hash;
+
+    const char* data = name.data();
+    size_t size = name.size();
+    uint64_t hash = prime ^ size;
+
+#ifdef NAME_HASH_AVX2
+    for (; size >= 32; data += 32, size -= 32)
+    {
+        alignas(32) uint64_t words[4];
+        _mm256_store_si256((__m256i*)words,
+            Fold(_mm256_loadu_si256((const __m256i*)data)));
+
+        for (uint64_t word : words) hash = Mix(hash, word);
+    }
+#endif
+
+#ifdef NAME_HASH_SSE2
+    for (; size >= 16; data += 16, size -= 16)
+    {
+        alignas(16) uint64_t words[2];
+        _mm_store_si128((__m128i*)words,
+            Fold(_mm_loadu_si128((const __m128i*)data)));
+
+        hash = Mix(hash, words[0]);
+        hash = Mix(hash, words[1]);
+    }
+#endif
+
+    for (; size >= 8; data += 8, size -= 8)
+    {
+        hash = Mix(hash, Fold(Load(data, 8)));
+    }
+
+    // The tail is padded with zeros
+    if (size) hash = Mix(hash, Fold(Load(data, size)));
+
+    hash ^= hash >> 32;
+    return (size_t)hash;
+}
+
+// Case-insensitive equality of names in the same sense as NameHash
+inline bool NameEquals(std::string_view name1, std::string_view name2)
+{
+    using namespace name_hash;
+
+    if (name1.size() != name2.size()) return false;
+
+    const char* data1 = name1.data();
+    const char* data2 = name2.data();
+    size_t size = name1.size();
+
+    for (; size >= 8; data1 += 8, data2 += 8, size -= 8)
+    {
+        if (Fold(Load(data1, 8)) != Fold(Load(data2, 8))) return false;
+    }
+
+    return !size || Fold(Load(data1, size)) == Fold(Load(data2, size));
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* A file written at given offsets, so that several threads can
+write parts of it at once without sharing a position */
+class OutputFile
+{
+private:
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+#else
+    int fd_ = -1;
+#endif
+
+public:
+    OutputFile() = default;
+    OutputFile(const OutputFile&) = delete;
+    explicit OutputFile(const std::filesystem::path& path) { Open(path); }
+    ~OutputFile() { Close(); }
+
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    // The file is created anew, or emptied if it exists
+    bool Open(const std::filesystem::path& path);
+    bool Close();
+
+    // Sets the file's size up front, with its space allocated where supported
+    bool Resize(uint64_t size);
+
+    bool WriteAt(const char* data, size_t size, uint64_t offset) const;
+
+#ifdef _WIN32
+    bool IsOpen() const { return file_ != INVALID_HANDLE_VALUE; }
+#else
+    bool IsOpen() const { return fd_ >= 0; }
+#endif
+};
+
+#ifdef _WIN32
+inline bool OutputFile::Open(const std::filesystem::path& path)
+{
+    Close();
+
+    // Writes are overlapped, so that they do not wait for each other
+    file_ = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ,
+        nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+    return IsOpen();
+}
+
+inline bool OutputFile::Close()
+{
+    if (!IsOpen()) return true;
+
+    bool is_closed = CloseHandle(file_);
+    file_ = INVALID_HANDLE_VALUE;
+    return is_closed;
+}
+
+inline bool OutputFile::Resize(uint64_t size)
+{
+    LARGE_INTEGER end;
+    end.QuadPart = (LONGLONG)size;
+    return SetFilePointerEx(file_, end, nullptr, FILE_BEGIN) &&
+        SetEndOfFile(file_);
+}
+
+inline bool OutputFile::WriteAt(const char* data, size_t size,
+    uint64_t offset) const
+{
+    // Each write waits on an event of its own, as several are in flight
+    HANDLE event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!event) return false;
+
+    bool is_written = true;
+    while (size && is_written)
+    {
+        OVERLAPPED overlapped{};
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        overlapped.hEvent = event;
+
+        DWORD n_bytes = 0;
+        DWORD n_to_write = (DWORD)std::min<size_t>(size, 1 << 30);
+
+        is_written = (WriteFile(file_, data, n_to_write, nullptr, &overlapped) ||
+                GetLastError() == ERROR_IO_PENDING) &&
+            GetOverlappedResult(file_, &overlapped, &n_bytes, TRUE) &&
+            n_bytes;
+
+        data += n_bytes;
+        size -= n_bytes;
+        offset += n_bytes;
+    }
+
+    CloseHandle(event);
+    return is_written;
+}
+#else
+inline bool OutputFile::Open(const std::filesystem::path& path)
+{
+    Close();
+
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    return IsOpen();
+}
+
+inline bool OutputFile::Close()
+{
+    if (!IsOpen()) return true;
+
+    bool is_closed = !close(fd_);
+    fd_ = -1;
+    return is_closed;
+}
+
+inline bool OutputFile::Resize(uint64_t size)
+{
+#ifdef __linux__
+    if (!fallocate(fd_, 0, 0, (off_t)size)) return true;
+#endif
+    // Otherwise the file is only extended
+    return !ftruncate(fd_, (off_t)size);
+}
+
+inline bool OutputFile::WriteAt(const char* data, size_t size,
+    uint64_t offset) const
+{
+    while (size)
+    {
+        ssize_t n_bytes = pwrite(fd_, data, size, (off_t)offset);
+        if (n_bytes < 0 && errno == EINTR) continue;
+        if (n_bytes <= 0) return false;
+
+        data += n_bytes;
+        size -= (size_t)n_bytes;
+        offset += (uint64_t)n_bytes;
+    }
+    return true;
+}
+#endif
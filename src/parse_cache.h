@@ -0,0 +1,122 @@
+#pragma once
+#include <cstdint>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+
+/* A store of parsed assets addressed by the hashes of their files'
+contents, so that a file once parsed is never parsed again in any
+tree it is found in.  Records are opaque to backends.  Backends are
+called from several parsing threads at once, and a miss or a failed
+store only costs a parse, so they report no errors. */
+class ParseCacheBackend
+{
+public:
+    virtual ~ParseCacheBackend() = default;
+
+    // The record stored under the key, if there is one
+    virtual std::optional<std::string> Load(uint64_t key) = 0;
+
+    // Stores the record under the key unless it is already there
+    virtual void Store(uint64_t key, std::string_view record) = 0;
+};
+
+/* A parse cache in a local directory, one file per record.  Records
+are written to temporary files first and are renamed into place, so
+that processes sharing the directory never see a partial record.
+Records under the same key are the same, whoever writes them. */
+class LocalParseCache : public ParseCacheBackend
+{
+private:
+    // Tells records of other formats apart
+    constexpr static char signature[] = "ACPC\1\0\0\0";
+    constexpr static size_t header_size = sizeof(signature) - 1 + 8;
+
+    std::filesystem::path directory_;
+
+private:
+    std::filesystem::path RecordPath(uint64_t key) const
+    {
+        char name[17];
+        for (int i = 15; i >= 0; --i, key >>= 4)
+        {
+            name[i] = "0123456789abcdef"[key & 0xf];
+        }
+        name[16] = '\0';
+
+        // Records are spread over 256 sub-directories
+        return directory_ / std::string_view(name, 2) / name;
+    }
+
+public:
+    explicit LocalParseCache(std::filesystem::path directory) :
+        directory_{std::move(directory)}
+    {}
+
+    std::optional<std::string> Load(uint64_t key) override
+    {
+        std::ifstream ifs(RecordPath(key), std::ios::binary | std::ios::ate);
+        if (!ifs.is_open()) return std::nullopt;
+
+        std::streamoff size = ifs.tellg();
+        if (size < (std::streamoff)header_size) return std::nullopt;
+
+        std::string record((size_t)size, '\0');
+        ifs.seekg(0);
+        if (!ifs.read(record.data(), size)) return std::nullopt;
+
+        // The key is kept as well in case a file is misplaced
+        std::string_view header(record.data(), header_size);
+        if (header.substr(0, header_size - 8) !=
+            std::string_view(signature, header_size - 8) ||
+            header.substr(header_size - 8) !=
+            std::string_view((const char*)&key, 8))
+        {
+            return std::nullopt;
+        }
+
+        record.erase(0, header_size);
+        return record;
+    }
+
+    void Store(uint64_t key, std::string_view record) override
+    {
+        namespace fs = std::filesystem;
+
+        fs::path path = RecordPath(key);
+        std::error_code ec;
+        if (fs::exists(path, ec)) return;
+        fs::create_directories(path.parent_path(), ec);
+
+        // Unique among threads and processes writing at once
+        fs::path temp_path = path;
+        temp_path += '.' + std::to_string(
+            std::hash<std::thread::id>{}(std::this_thread::get_id()) ^
+            (size_t)std::chrono::steady_clock::now().time_since_epoch().count());
+
+        {
+            std::ofstream ofs(temp_path, std::ios::binary);
+            if (!ofs.is_open()) return;
+
+            ofs.write(signature, header_size - 8);
+            ofs.write((const char*)&key, 8);
+            ofs.write(record.data(), record.size());
+            if (!ofs.flush())
+            {
+                ofs.close();
+                fs::remove(temp_path, ec);
+                return;
+            }
+        }
+
+        // Losing a race to another writer is fine
+        fs::rename(temp_path, path, ec);
+        if (ec) fs::remove(temp_path, ec);
+    }
+};
@@ -0,0 +1,174 @@
+#pragma once
+#include "flat_hash_map.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/* Interns names, so that every spelling is stored once and is
+referred to by a 32-bit id.  Ids are dense within each shard,
+and shards are locked separately, so that several threads may
+intern names at once.  Each symbol also knows the id of its
+lower-case spelling (its class), which identifies the name up
+to the case of ASCII letters. */
+class SymbolTable
+{
+private:
+    constexpr static uint32_t shard_bits = 4;
+    constexpr static uint32_t n_shards = 1 << shard_bits;
+
+    /* Symbols are kept in blocks which never move, so that
+    they can be read without locking. */
+    constexpr static uint32_t block_bits = 12;
+    constexpr static uint32_t block_size = 1 << block_bits;
+    constexpr static uint32_t max_blocks = 1 << 12;
+
+    // Spellings and blocks are allocated from arenas of the shards
+    constexpr static size_t arena_block_size = 1 << 16;
+
+    // The longest name lowered without a heap allocation
+    constexpr static size_t max_short_name = 0xff;
+
+    struct Symbol
+    {
+        std::string_view spelling{};
+        uint32_t class_id = 0;
+    };
+
+    struct ExactHasher
+    {
+        size_t operator()(std::string_view sv) const
+        {
+            return std::hash<std::string_view>{}(sv);
+        }
+    };
+
+    struct ExactEquals
+    {
+        bool operator()(std::string_view sv1, std::string_view sv2) const
+        {
+            return sv1 == sv2;
+        }
+    };
+
+    struct Shard
+    {
+        std::mutex mutex{};
+        FlatHashMap<std::string_view, uint32_t,
+            ExactHasher, ExactEquals> ids{};
+        std::pmr::monotonic_buffer_resource arena{arena_block_size};
+        Symbol* blocks[max_blocks]{};
+        uint32_t size = 0;
+    };
+
+    std::unique_ptr<Shard[]> shards_ = std::make_unique<Shard[]>(n_shards);
+
+public:
+    // Calls fn with the spelling in the lower case
+    template <typename Fn>
+    static auto ToLower(std::string_view spelling, Fn&& fn)
+    {
+        auto lower = [](char c)
+        {
+            return (c >= 'A' && c <= 'Z') ? (char)(c | 0x20) : c;
+        };
+
+        if (spelling.size() > max_short_name)
+        {
+            std::string buffer(spelling);
+            for (char& c : buffer) c = lower(c);
+            return fn(std::string_view(buffer));
+        }
+
+        char buffer[max_short_name];
+        for (size_t i = 0; i < spelling.size(); ++i) buffer[i] = lower(spelling[i]);
+        return fn(std::string_view(buffer, spelling.size()));
+    }
+
+private:
+    const Symbol& Get(uint32_t id) const
+    {
+        const Shard& shard = shards_[id & (n_shards - 1)];
+        uint32_t i = id >> shard_bits;
+        return shard.blocks[i >> block_bits][i & (block_size - 1)];
+    }
+
+    static bool IsLower(std::string_view spelling)
+    {
+        for (char c : spelling)
+        {
+            if (c >= 'A' && c <= 'Z') return false;
+        }
+
+        return true;
+    }
+
+    uint32_t Intern(std::string_view spelling, size_t hash, bool is_lower)
+    {
+        Shard& shard = shards_[hash & (n_shards - 1)];
+
+        {
+            std::lock_guard lock(shard.mutex);
+
+            auto pos = shard.ids.find(spelling, hash);
+            if (pos != shard.ids.end()) return pos->second;
+        }
+
+        /* The class is interned beforehand, since
+        no two shards are ever locked together */
+        uint32_t class_id = is_lower ? 0 : ToLower(spelling,
+            [this](std::string_view lower) { return Intern(lower); });
+
+        std::lock_guard lock(shard.mutex);
+
+        // Another thread might have interned the name in the meantime
+        auto pos = shard.ids.find(spelling, hash);
+        if (pos != shard.ids.end()) return pos->second;
+
+        uint32_t i = shard.size;
+        if ((i >> block_bits) >= max_blocks)
+        {
+            throw std::length_error("Too many names to intern!");
+        }
+
+        Symbol*& block = shard.blocks[i >> block_bits];
+        if (!block)
+        {
+            block = new (shard.arena.allocate(block_size * sizeof(Symbol), 
+                alignof(Symbol))) Symbol[block_size];
+        }
+
+        /* Spellings are copied, since the table outlives the 
+        buffers and mappings names are read from */
+        char* data = (char*)shard.arena.allocate(spelling.size(), 1);
+        std::copy(spelling.begin(), spelling.end(), data);
+        std::string_view stored(data, spelling.size());
+
+        uint32_t new_id = (i << shard_bits) | (uint32_t)(hash & (n_shards - 1));
+        shard.ids.emplace(stored, hash) = new_id;
+
+        block[i & (block_size - 1)] = { stored, is_lower ? new_id : class_id };
+        ++shard.size;
+
+        return new_id;
+    }
+
+public:
+    SymbolTable() = default;
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    uint32_t Intern(std::string_view spelling)
+    {
+        return Intern(spelling, ExactHasher{}(spelling), IsLower(spelling));
+    }
+
+    std::string_view Name(uint32_t id) const { return Get(id).spelling; }
+    uint32_t Class(uint32_t id) const { return Get(id).class_id; }
+};
\ No newline at end of file
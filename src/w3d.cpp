@@ -1,670 +1,736 @@
 #include "w3d.h"
-#include "binary_io.h"
 #include "container_utils.h"
 
 #include <cassert>
-#include <iostream>
+#include <format>
 #include <filesystem>
 #include <chrono>
 
-const std::unordered_map<uint32_t, ChunkType>
-Asset::Chunk::PRIMARY_CHUNKS
-{
-    {0x00'54'45'58 /*TEX*/, ChunkType::W3D_TEXTURE_FILE},
-    {0x4d'45'53'48 /*MESH*/, ChunkType::W3D_CHUNK_MESH},
-    {0x48'49'45'52 /*HIER*/, ChunkType::W3D_CHUNK_HIERARCHY},
-    {0x41'4e'49'4d /*ANIM*/, ChunkType::W3D_CHUNK_ANIMATION},
-    {0x50'41'52'54 /*PART*/, ChunkType::W3D_CHUNK_EMITTER},
-    {0x41'47'47'52 /*AGGR*/, ChunkType::W3D_CHUNK_AGGREGATE},
-    {0x48'4c'4f'44 /*HLOD*/, ChunkType::W3D_CHUNK_HLOD},
-    {0x00'42'4f'58 /*BOX*/, ChunkType::W3D_CHUNK_BOX}
-};
-
-const std::unordered_map<ChunkType, uint32_t>
-Asset::Chunk::PRIMARY_CHUNKS_INV
-{
-    {ChunkType::W3D_TEXTURE_FILE, /*TEX*/ 0x00'54'45'58},
-    {ChunkType::W3D_CHUNK_MESH, /*MESH*/ 0x4d'45'53'48},
-    {ChunkType::W3D_CHUNK_HIERARCHY, /*HIER*/ 0x48'49'45'52},
-    {ChunkType::W3D_CHUNK_ANIMATION, /*ANIM*/ 0x41'4e'49'4d},
-    {ChunkType::W3D_CHUNK_COMPRESSED_ANIMATION, /*ANIM*/ 0x41'4e'49'4d},
-    {ChunkType::W3D_CHUNK_EMITTER, /*PART*/ 0x50'41'52'54},
-    {ChunkType::W3D_CHUNK_AGGREGATE, /*AGGR*/ 0x41'47'47'52},
-    {ChunkType::W3D_CHUNK_HLOD, /*HLOD*/ 0x48'4c'4f'44},
-    {ChunkType::W3D_CHUNK_BOX, /*BOX*/ 0x00'42'4f'58 }
-};
+SymbolTable Asset::symbols{};
 
-template <typename T>
-T ReadChunkSize(std::ifstream& ifs)
+constinit const std::array<Asset::Chunk::Descriptor, 0x100>
+Asset::Chunk::DESCRIPTORS = []()
 {
-    T out = ReadPrimitive<T>(ifs);
+    std::array<Descriptor, 0x100> out{};
+
+    auto add = [&out](ChunkType type, uint32_t tag, Reader read)
+    {
+        out[(uint32_t)type >> 4] = { tag, read };
+    };
+
+    add(ChunkType::W3D_CHUNK_MESH, 0x4d'45'53'48 /*MESH*/, &Chunk::ReadMesh);
+    add(ChunkType::W3D_CHUNK_HIERARCHY, 0x48'49'45'52 /*HIER*/, &Chunk::ReadHierarchy);
+    add(ChunkType::W3D_CHUNK_ANIMATION, 0x41'4e'49'4d /*ANIM*/, &Chunk::ReadAnimation);
+    add(ChunkType::W3D_CHUNK_COMPRESSED_ANIMATION, 0x41'4e'49'4d /*ANIM*/, &Chunk::ReadCompressedAnimation);
+    add(ChunkType::W3D_CHUNK_EMITTER, 0x50'41'52'54 /*PART*/, &Chunk::ReadEmitter);
+    add(ChunkType::W3D_CHUNK_AGGREGATE, 0x41'47'47'52 /*AGGR*/, &Chunk::ReadAggregate);
+    add(ChunkType::W3D_CHUNK_HLOD, 0x48'4c'4f'44 /*HLOD*/, &Chunk::ReadHLoD);
+    add(ChunkType::W3D_CHUNK_BOX, 0x00'42'4f'58 /*BOX*/, &Chunk::ReadBox);
+
+    // Textures are separate files rather than chunks of W3D files
+    add(ChunkType::W3D_TEXTURE_FILE, 0x00'54'45'58 /*TEX*/, nullptr);
+
+    /* .dat files have no tags for these types, so their chunks 
+    are read for names and inputs, but are not cached.  Lights 
+    have no names, so only their info is checked for. */
+    add(ChunkType::W3D_CHUNK_MORPH_ANIMATION, 0, &Chunk::ReadMorphAnimation);
+    add(ChunkType::W3D_CHUNK_LODMODEL, 0, &Chunk::ReadLoDModel);
+    add(ChunkType::W3D_CHUNK_COLLECTION, 0, &Chunk::ReadCollection);
+    add(ChunkType::W3D_CHUNK_LIGHT, 0, &Chunk::ReadLight);
+    add(ChunkType::W3D_CHUNK_NULL_OBJECT, 0, &Chunk::ReadNullObject);
+    add(ChunkType::W3D_CHUNK_DAZZLE, 0, &Chunk::ReadDazzle);
+    add(ChunkType::W3D_CHUNK_SOUNDROBJ, 0, &Chunk::ReadSoundObject);
 
-    /* Chopping off the leading byte, which is reserved to 
-    indicate whether there are sub-chunks */
-    ((char*)&out)[sizeof(out) - 1] &= 0x0f;
     return out;
-}
+}();
 
-void Asset::Chunk::ReadInfoDat(augmented::ifstream& ifs)
+const Asset::Chunk::Descriptor& Asset::Chunk::Describe(ChunkType type)
 {
-    name = ReadShortString(ifs.FS());
+    const static Descriptor none{};
 
+    uint32_t i = (uint32_t)type;
+    return (i & 0x0f || i >= 0x1000) ? none : DESCRIPTORS[i >> 4];
+}
+
+ChunkType Asset::Chunk::TypeOfTag(uint32_t tag)
+{
+    switch (tag)
     {
-        uint32_t fixed_type = ReadPrimitive<uint32_t>(ifs.FS());
-
-        /* Fixing a stray byte in BOX chunks from a .dat file 
-        generated by AssetBuilder. */
-        ((char*)&fixed_type)[3] = (((char*)&fixed_type)[2] == 'B')
-            ? '\0' : ((char*)&fixed_type)[3];
-        
-        type = PRIMARY_CHUNKS.at(fixed_type);   
+    case 0x00'54'45'58 /*TEX*/: return ChunkType::W3D_TEXTURE_FILE;
+    case 0x4d'45'53'48 /*MESH*/: return ChunkType::W3D_CHUNK_MESH;
+    case 0x48'49'45'52 /*HIER*/: return ChunkType::W3D_CHUNK_HIERARCHY;
+    case 0x41'4e'49'4d /*ANIM*/: return ChunkType::W3D_CHUNK_ANIMATION;
+    case 0x50'41'52'54 /*PART*/: return ChunkType::W3D_CHUNK_EMITTER;
+    case 0x41'47'47'52 /*AGGR*/: return ChunkType::W3D_CHUNK_AGGREGATE;
+    case 0x48'4c'4f'44 /*HLOD*/: return ChunkType::W3D_CHUNK_HLOD;
+    case 0x00'42'4f'58 /*BOX*/: return ChunkType::W3D_CHUNK_BOX;
+    default: throw std::out_of_range("Unknown chunk tag: ");
     }
+}
 
-    offset = ReadPrimitive<uint32_t>(ifs.FS());
-    size = ReadPrimitive<uint32_t>(ifs.FS());
+bool Asset::Chunk::IsCached(ChunkType type)
+{
+    return Describe(type).tag;
 }
 
-void Asset::Chunk::ReadInfoW3D(augmented::ifstream& ifs)
+template <typename T>
+T ReadChunkSize(BinaryReader& reader)
 {
-    offset = ifs.FS().tellg();
-    type = (ChunkType)ReadPrimitive<uint32_t>(ifs.FS());
-    
-    switch (type)
+    T out = reader.Read<T>();
+
+    /* Chopping off the leading byte, which is reserved to 
+    indicate whether there are sub-chunks */
+    ((char*)&out)[sizeof(out) - 1] &= 0x0f;
+    return out;
+}
+
+bool ChunkIndex::IsContainer(uint32_t type, bool is_root)
+{
+    switch ((ChunkType)type)
     {
-    case ChunkType::W3D_CHUNK_MESH:
-        ReadMesh(ifs.FS());
-        break;
+    case ChunkType::W3D_CHUNK_PRELIT_UNLIT:
+    case ChunkType::W3D_CHUNK_PRELIT_VERTEX:
+    case ChunkType::W3D_CHUNK_PRELIT_LIGHTMAP_MULTI_PASS:
+    case ChunkType::W3D_CHUNK_PRELIT_LIGHTMAP_MULTI_TEXTURE:
+    case ChunkType::W3D_CHUNK_VERTEX_MATERIALS:
+    case ChunkType::W3D_CHUNK_VERTEX_MATERIAL:
+    case ChunkType::W3D_CHUNK_TEXTURES:
+    case ChunkType::W3D_CHUNK_TEXTURE:
+    case ChunkType::W3D_CHUNK_MATERIAL_PASS:
+    case ChunkType::W3D_CHUNK_TEXTURE_STAGE:
+    case ChunkType::W3D_CHUNK_SHADER_MATERIALS:
+    case ChunkType::W3D_CHUNK_SHADER_MATERIAL:
+    case ChunkType::W3D_CHUNK_AABTREE:
+    case ChunkType::W3D_CHUNK_MORPHANIM_CHANNEL:
+    case ChunkType::W3D_CHUNK_HLOD_LOD_ARRAY:
+    case ChunkType::W3D_CHUNK_HLOD_AGGREGATE_ARRAY:
+    case ChunkType::W3D_CHUNK_HLOD_PROXY_ARRAY:
+    case ChunkType::W3D_CHUNK_LIGHTSCAPE_LIGHT:
+        return true;
 
+    case ChunkType::W3D_CHUNK_MESH:
     case ChunkType::W3D_CHUNK_HIERARCHY:
-        ReadHierarchy(ifs.FS());
-        break;
-
     case ChunkType::W3D_CHUNK_ANIMATION:
-        ReadAnimation(ifs.FS());
-        break;
-    
     case ChunkType::W3D_CHUNK_COMPRESSED_ANIMATION:
-        ReadCompressedAnimation(ifs.FS());
-        break;
-
+    case ChunkType::W3D_CHUNK_MORPH_ANIMATION:
+    case ChunkType::W3D_CHUNK_HMODEL:
+    case ChunkType::W3D_CHUNK_LODMODEL:
+    case ChunkType::W3D_CHUNK_COLLECTION:
+    case ChunkType::W3D_CHUNK_LIGHT:
     case ChunkType::W3D_CHUNK_EMITTER:
-        ReadEmitter(ifs.FS());
-        break;
-
     case ChunkType::W3D_CHUNK_AGGREGATE:
-        ReadAggregate(ifs.FS());
-        break;
-    
     case ChunkType::W3D_CHUNK_HLOD:
-        ReadHLoD(ifs.FS());
-        break;
-    
-    case ChunkType::W3D_CHUNK_BOX:
-        ReadBox(ifs.FS());
-        break;
+    case ChunkType::W3D_CHUNK_LIGHTSCAPE:
+    case ChunkType::W3D_CHUNK_DAZZLE:
+    case ChunkType::W3D_CHUNK_SOUNDROBJ:
+        return is_root;
 
     default:
-        Skip(ifs.FS());
-        throw std::runtime_error("Unsupported chunk type encountered: ");
+        return false;
     }
+}
+
+void ChunkIndex::Build(BinaryReader reader, size_t offset)
+{
+    using invalid_file_format = Asset::invalid_file_format;
 
-    // Translating all input names into the lower register
-    for (std::string& input_name : inputs)
+    // Offsets of entries are 32-bit
+    if (reader.Size() > 0xff'ff'ff'ff)
     {
-        for (char& c : input_name) c = std::tolower(c);
+        throw invalid_file_format("The file is too large");
     }
-    
-    // Sorting the vector of inputs
-    QuickSort(inputs.begin(), inputs.end());
 
-    SetUpValidities();
-}
+    entries_.clear();
+    data_ = reader.Data();
+    reader.Seek(offset);
 
-void Asset::Chunk::Skip(std::ifstream& ifs)
-{
-    uint32_t chunk_size = ReadChunkSize<uint32_t>(ifs);
-    ifs.seekg(chunk_size, std::ios::cur);
-}
+    // Containers whose sub-chunks are still being indexed
+    std::vector<uint32_t> parents;
 
-template <typename Fn>
-void Asset::Chunk::ReadHeader(std::ifstream& ifs, 
-    ChunkType exp_header_type, 
-    uint32_t exp_header_size, 
-    uint32_t min_version, 
-    Fn&& fn, 
-    uint8_t name_offset)
-{
+    do
     {
-        // The header must be of the correct type
-        uint32_t header_type = ReadPrimitive<uint32_t>(ifs);
-        if (header_type != (uint32_t)exp_header_type)
+        uint32_t i = (uint32_t)entries_.size();
+        Entry& entry = entries_.emplace_back();
+
+        entry.offset = (uint32_t)reader.Tell();
+        entry.type = reader.Read<uint32_t>();
+
+        uint32_t raw_size = reader.Read<uint32_t>();
+        entry.size = raw_size & 0x0f'ff'ff'ff;
+        entry.next = i + 1;
+
+        // The data must fit into the container and the file, but it is not read
+        if (parents.size() && 
+            entry.End() > entries_[parents.back()].End())
         {
-            throw invalid_file_format("Chunk header is expected: ");
+            throw invalid_file_format(std::format("Sub-chunk 0x{:X} at 0x{:X} "
+                "overruns its container", entry.type, entry.offset));
         }
-    }
 
-    {
-        // The header must have a fixed size
-        uint32_t header_size = ReadChunkSize<uint32_t>(ifs);
-        if (header_size != exp_header_size)
+        if (entry.End() > reader.Size())
         {
-            throw invalid_file_format("Unexpected size of the chunk header: ");
+            throw invalid_file_format(i ? std::format("Sub-chunk 0x{:X} at 0x{:X} "
+                "runs past the end of the file", entry.type, entry.offset) : 
+                "Chunk runs past the end of the file");
         }
-    }
-    
-    uint32_t header_offset = ifs.tellg();
 
-    {
-        // Older versions might be unsupported
-        uint32_t header_version = ReadChunkSize<uint32_t>(ifs);
-        if (header_version < min_version)
+        // Only containers are descended into, flagged or known ones
+        if ((raw_size & 0x80'00'00'00) || IsContainer(entry.type, !i))
         {
-            throw invalid_file_format("Unsupported chunk version: ");
+            parents.push_back(i);
+            reader.Seek(entry.DataOffset());
         }
-    }
-
-    // Skipping attributes or whatever it is before the name begins
-    ifs.seekg(name_offset, std::ios::cur);
+        else reader.Seek(entry.End());
 
-    fn();
+        // Closing containers with no room left for another sub-chunk
+        while (parents.size() && 
+            reader.Tell() + 0x08 > entries_[parents.back()].End())
+        {
+            reader.Seek(entries_[parents.back()].End());
+            entries_[parents.back()].next = (uint32_t)entries_.size();
+            parents.pop_back();
+        }
+    }
+    while (parents.size());
+}
 
-    // Skipping the rest of the header
-    ifs.seekg(header_offset + exp_header_size);
+uint32_t ChunkIndex::FindChild(uint32_t i, ChunkType type) const
+{
+    for (uint32_t j = i + 1; j < entries_[i].next; j = entries_[j].next)
+    {
+        if (entries_[j].type == (uint32_t)type) return j;
+    }
+    
+    return npos;
 }
 
-void Asset::Chunk::ReadHeaderName(std::ifstream& ifs, 
-    ChunkType exp_header_type, 
-    uint32_t exp_header_size, 
-    uint32_t exp_version, 
-    uint8_t name_offset)
+uint32_t Asset::Chunk::FixTag(uint32_t tag)
 {
-    ReadHeader(ifs, 
-        exp_header_type, exp_header_size, exp_version, 
-        [this, &ifs]()
-        {
-            name = ReadFixedSizeString(ifs, W3D_MAX_STRING_LENGTH);
-        }, 
-        name_offset);
+    /* Fixing a stray byte in BOX chunks from a .dat file 
+    generated by AssetBuilder. */
+    ((char*)&tag)[3] = (((char*)&tag)[2] == 'B')
+        ? '\0' : ((char*)&tag)[3];
+    
+    return tag;
 }
 
-template <typename Fn>
-void Asset::Chunk::ReadFromSubChunks(std::ifstream& ifs, 
-    uint32_t end_pos, 
-    ChunkType exp_chunk_type, 
-    Fn&& fn)
+ChunkType Asset::Chunk::ReadTypeDat(BinaryReader& reader)
 {
-    while (ifs.tellg() < end_pos)
-    {
-        uint32_t type = ReadPrimitive<uint32_t>(ifs);
+    return TypeOfTag(FixTag(reader.Read<uint32_t>()));
+}
 
-        if (type == (uint32_t)exp_chunk_type) fn();
-        else Skip(ifs);
-    };
+bool Asset::Chunk::IsCanonicalTag(uint32_t tag)
+{
+    return Describe(TypeOfTag(FixTag(tag))).tag == tag;
 }
 
-void Asset::Chunk::ReadMesh(std::ifstream& ifs)
+Asset::Chunk::ReadStatus Asset::Chunk::ReadInfoW3D(BinaryReader& reader)
 {
-    /* Gross size accounting for 4 + 4 bytes used for 
-    the type and the size */
-    size = ReadChunkSize<uint32_t>(ifs) + 0x08;
+    offset = reader.Tell();
+    type = (ChunkType)reader.Read<uint32_t>();
+    
+    const Descriptor& descriptor = Describe(type);
+    if (!descriptor.read)
+    {
+        Skip(reader);
+        return ReadStatus::Skipped;
+    }
 
-    ReadHeader(ifs, 
-        ChunkType::W3D_CHUNK_MESH_HEADER3, 
-        0x74, 0x00'04'00'02,  
-        [this, &ifs]()
-        {
-            ifs.seekg(0x04, std::ios::cur); // skipping attributes
+    try
+    {
+        /* Only the tree of sub-chunk headers is scanned, readers 
+        then jump straight to the bytes they need */
+        ChunkIndex index(reader, offset);
 
-            std::string full_name;
-            full_name.reserve(2 * W3D_MAX_STRING_LENGTH + 1); // +1 accounts for the separating '.'
+        /* Gross size accounting for 4 + 4 bytes used for 
+        the type and the size */
+        size = index[0].size + 0x08;
 
-            std::string mesh_name = ReadFixedSizeString(ifs, W3D_MAX_STRING_LENGTH);
-            std::string container_name = ReadFixedSizeString(ifs, W3D_MAX_STRING_LENGTH);
+        (this->*descriptor.read)(index, 0);
 
-            full_name += std::move(container_name);
-            if (container_name.size()) full_name += '.';
-            full_name += std::move(mesh_name);
+        // Skipping whatever else is there
+        reader.Seek(index[0].End());
+    }
+    catch (const invalid_file_format& e)
+    {
+        if (!descriptor.tag) return SkipCorrupted(reader);
+        throw invalid_file_format(std::format("{} (chunk 0x{:X} at 0x{:X}): ", 
+            e.what(), (uint32_t)type, offset));
+    }
+    catch (const std::out_of_range&)
+    {
+        // Readers are confined to sub-chunks, which are truncated then
+        if (!descriptor.tag) return SkipCorrupted(reader);
+        throw invalid_file_format(std::format("Chunk data is truncated "
+            "(chunk 0x{:X} at 0x{:X}): ", (uint32_t)type, offset));
+    }
 
-            name = std::move(full_name);
+    // Sorting the vector of inputs by their names
+    QuickSort(inputs.begin(), inputs.end(), 
+        [](uint32_t id1, uint32_t id2)
+        {
+            return symbols.Name(id1) < symbols.Name(id2);
         });
 
-    ReadFromSubChunks(ifs, offset + size, 
-        ChunkType::W3D_CHUNK_TEXTURES, 
-        [this, &ifs]() { ReadMeshTextures(ifs); });
-    
-    // Skipping whatever else is there
-    ifs.seekg(offset + size);
+    name_id = symbols.Intern(name);
+
+    return ReadStatus::Read;
 }
 
-void Asset::Chunk::ReadMeshTextures(std::ifstream& ifs)
+Asset::Chunk::ReadStatus Asset::Chunk::SkipCorrupted(BinaryReader& reader)
 {
-    uint32_t chunk_size = ReadChunkSize<uint32_t>(ifs);
-    uint32_t chunk_offset = ifs.tellg();
+    /* Chunks, which are not cached, never fail the whole file,
+    so a corrupted one is skipped as if it were unsupported */
+    reader.Seek(offset + 0x04);
+    Skip(reader);
 
-    // Scans a texture chunk, adds the name to the vector of inputs
-    ReadFromSubChunks(ifs, chunk_offset + chunk_size, 
-        ChunkType::W3D_CHUNK_TEXTURE, 
-        [this, &ifs]()
-        {
-            uint32_t chunk_size = ReadChunkSize<uint32_t>(ifs);
-            uint32_t chunk_offset = ifs.tellg();
-            
-            while (ifs.tellg() < chunk_offset + chunk_size)
-            {
-                uint32_t sub_chunk_type = ReadPrimitive<uint32_t>(ifs);
-                
-                if (sub_chunk_type == (uint32_t)ChunkType::W3D_CHUNK_TEXTURE_NAME)
-                {
-                    uint32_t sub_chunk_size = ReadChunkSize<uint32_t>(ifs);
-                    std::string texture_name = ReadFixedSizeString(ifs, sub_chunk_size);
-                    inputs.emplace_back(std::move(texture_name));
-                }
-                else Skip(ifs);
-            }
-        });
+    inputs.clear();
+    return ReadStatus::Skipped;
 }
 
-void Asset::Chunk::ReadHierarchy(std::ifstream& ifs)
+void Asset::Chunk::AddInput(std::string_view input)
 {
-    /* Gross size accounting for 4 + 4 bytes used for 
-    the type and the size */
-    size = ReadChunkSize<uint32_t>(ifs) + 0x08;
+    // Input names are kept in the lower register
+    inputs.push_back(SymbolTable::ToLower(input, 
+        [](std::string_view lower) { return symbols.Intern(lower); }));
+}
 
-    ReadHeader(ifs, 
-        ChunkType::W3D_CHUNK_HIERARCHY_HEADER, 
-        0x24, 0x00'04'00'01, 
-        [this, &ifs]()
-        {
-            std::string full_name = "H*";
-            full_name += ReadFixedSizeString(ifs, W3D_MAX_STRING_LENGTH);
-            name = std::move(full_name);
-        });
-    
-    // Skipping whatever else is there
-    ifs.seekg(offset + size);
+void Asset::Chunk::Skip(BinaryReader& reader)
+{
+    uint32_t chunk_size = ReadChunkSize<uint32_t>(reader);
+    reader.Skip(chunk_size);
 }
 
-void Asset::Chunk::ReadAnimation(std::ifstream& ifs)
+template <typename Header>
+Header Asset::Chunk::ReadHeader(const ChunkIndex& index, 
+    uint32_t i, 
+    ChunkType exp_header_type, 
+    uint32_t min_version)
 {
-    /* Gross size accounting for 4 + 4 bytes used for 
-    the type and the size */
-    size = ReadChunkSize<uint32_t>(ifs) + 0x08;
+    // The header must be the first sub-chunk of the correct type
+    uint32_t header = index.FirstChild(i);
+    if (header == ChunkIndex::npos || 
+        index[header].type != (uint32_t)exp_header_type)
+    {
+        throw invalid_file_format("Chunk header is expected");
+    }
 
-    ReadHeader(ifs, 
-        ChunkType::W3D_CHUNK_ANIMATION_HEADER, 
-        0x2c, 0x00'04'00'01, 
-        [this, &ifs]()
-        {
-            std::string full_name;
-            full_name.reserve(2 * W3D_MAX_STRING_LENGTH + 3); // +3 accounts for "A*" and '.'
+    // The header must have a fixed size
+    if (index[header].size != sizeof(Header))
+    {
+        throw invalid_file_format("Unexpected size of the chunk header");
+    }
+    
+    Header out = index.Data(header).Read<Header>();
+
+    /* Older versions might be unsupported (the leading 
+    byte is chopped off as with chunk sizes) */
+    if ((out.version & 0x0fffffff) < min_version)
+    {
+        throw invalid_file_format("Unsupported chunk version");
+    }
 
-            std::string anim_name = ReadFixedSizeString(ifs, W3D_MAX_STRING_LENGTH);
-            std::string hier_name = ReadFixedSizeString(ifs, W3D_MAX_STRING_LENGTH);
+    return out;
+}
 
-            full_name += "A*";
-            full_name += std::move(hier_name);
-            full_name += '.';
-            full_name += std::move(anim_name);
+void Asset::Chunk::ReadMesh(const ChunkIndex& index, uint32_t i)
+{
+    W3dMeshHeader3 header = ReadHeader<W3dMeshHeader3>(index, i, 
+        ChunkType::W3D_CHUNK_MESH_HEADER3, 0x00'04'00'02);
 
-            name = std::move(full_name);
+    std::string_view container_name = FieldString(header.container_name);
+
+    name = container_name;
+    if (container_name.size()) name += '.';
+    name += FieldString(header.mesh_name);
+
+    // Only names of textures are read, vertices and the like are never touched
+    index.ForEachChild(i, ChunkType::W3D_CHUNK_TEXTURES, 
+        [this, &index](uint32_t textures)
+        {
+            index.ForEachChild(textures, ChunkType::W3D_CHUNK_TEXTURE, 
+                [this, &index](uint32_t texture)
+                {
+                    ReadMeshTexture(index, texture);
+                });
         });
-    
-    // Skipping whatever else is there
-    ifs.seekg(offset + size);
 }
 
-void Asset::Chunk::ReadCompressedAnimation(std::ifstream& ifs)
+void Asset::Chunk::ReadMeshTexture(const ChunkIndex& index, uint32_t i)
 {
-    /* Gross size accounting for 4 + 4 bytes used for 
-    the type and the size */
-    size = ReadChunkSize<uint32_t>(ifs) + 0x08;
-
-    ReadHeader(ifs, 
-        ChunkType::W3D_CHUNK_COMPRESSED_ANIMATION_HEADER, 
-        0x2c, 0x00'00'00'01, 
-        [this, &ifs]()
+    // Adds the texture's name to the vector of inputs
+    index.ForEachChild(i, ChunkType::W3D_CHUNK_TEXTURE_NAME, 
+        [this, &index](uint32_t name)
         {
-            std::string full_name;
-            full_name.reserve(2 * W3D_MAX_STRING_LENGTH + 3); // +3 accounts for "A*" and '.'
+            BinaryReader data = index.Data(name);
+            AddInput(data.ReadFixedSizeString(data.Size()));
+        });
+}
 
-            std::string anim_name = ReadFixedSizeString(ifs, W3D_MAX_STRING_LENGTH);
-            std::string hier_name = ReadFixedSizeString(ifs, W3D_MAX_STRING_LENGTH);
+void Asset::Chunk::ReadHierarchy(const ChunkIndex& index, uint32_t i)
+{
+    W3dHierarchyHeader header = ReadHeader<W3dHierarchyHeader>(index, i, 
+        ChunkType::W3D_CHUNK_HIERARCHY_HEADER, 0x00'04'00'01);
 
-            full_name += "A*";
-            full_name += std::move(hier_name);
-            full_name += '.';
-            full_name += std::move(anim_name);
+    name = "H*";
+    name += FieldString(header.name);
+}
 
-            name = std::move(full_name);
-        });
-    
-    // Skipping whatever else is there
-    ifs.seekg(offset + size);
+void Asset::Chunk::ReadAnimation(const ChunkIndex& index, uint32_t i)
+{
+    W3dAnimHeader header = ReadHeader<W3dAnimHeader>(index, i, 
+        ChunkType::W3D_CHUNK_ANIMATION_HEADER, 0x00'04'00'01);
+
+    name = "A*";
+    name += FieldString(header.hierarchy_name);
+    name += '.';
+    name += FieldString(header.name);
 }
 
-void Asset::Chunk::ReadEmitter(std::ifstream& ifs)
+void Asset::Chunk::ReadCompressedAnimation(const ChunkIndex& index, uint32_t i)
 {
-    /* Gross size accounting for 4 + 4 bytes used for 
-    the type and the size */
-    size = ReadChunkSize<uint32_t>(ifs) + 0x08;
+    W3dCompressedAnimHeader header = ReadHeader<W3dCompressedAnimHeader>(index, i, 
+        ChunkType::W3D_CHUNK_COMPRESSED_ANIMATION_HEADER, 0x00'00'00'01);
 
-    ReadHeaderName(ifs, 
-        ChunkType::W3D_CHUNK_EMITTER_HEADER, 
-        0x14, 0x00'02'00'00);
-    
-    // Scans an emitter info chunk, extracts the name of the texture
-    ReadFromSubChunks(ifs, offset + size, 
-        ChunkType::W3D_CHUNK_EMITTER_INFO, 
-        [this, &ifs]()
-        {
-            uint32_t chunk_size = ReadChunkSize<uint32_t>(ifs);
-            uint32_t chunk_offset = ifs.tellg();
-            
-            std::string texture_name = ReadFixedSizeString(ifs, 
-                MAX_SHORT_STRING_LENGTH);
-            
-            inputs.emplace_back(std::move(texture_name));
+    name = "A*";
+    name += FieldString(header.hierarchy_name);
+    name += '.';
+    name += FieldString(header.name);
+}
 
-            // Skipping whatever else is there
-            ifs.seekg(offset + size);
-        });
+void Asset::Chunk::ReadEmitter(const ChunkIndex& index, uint32_t i)
+{
+    name = FieldString(ReadHeader<W3dEmitterHeader>(index, i, 
+        ChunkType::W3D_CHUNK_EMITTER_HEADER, 0x00'02'00'00).name);
     
-    // Skipping whatever else is there
-    ifs.seekg(offset + size);
+    // The first emitter info chunk holds the name of the texture
+    uint32_t info = index.FindChild(i, ChunkType::W3D_CHUNK_EMITTER_INFO);
+    if (info == ChunkIndex::npos) return;
+
+    AddInput(index.Data(info).ReadFixedSizeString(MAX_SHORT_STRING_LENGTH));
 }
 
-void Asset::Chunk::ReadAggregate(std::ifstream& ifs)
+void Asset::Chunk::ReadAggregate(const ChunkIndex& index, uint32_t i)
 {
-    /* Gross size accounting for 4 + 4 bytes used for 
-    the type and the size */
-    size = ReadChunkSize<uint32_t>(ifs) + 0x08;
-
-    ReadHeaderName(ifs, 
-        ChunkType::W3D_CHUNK_AGGREGATE_HEADER,
-        0x14, 0x00'01'00'03);
+    name = FieldString(ReadHeader<W3dAggregateHeader>(index, i, 
+        ChunkType::W3D_CHUNK_AGGREGATE_HEADER, 0x00'01'00'03).name);
     
     // Extracting input chunks from other assets
-    ReadFromSubChunks(ifs, offset + size, 
-        ChunkType::W3D_CHUNK_AGGREGATE_INFO, 
-        [this, &ifs]()
+    index.ForEachChild(i, ChunkType::W3D_CHUNK_AGGREGATE_INFO, 
+        [this, &index](uint32_t info)
         {
-            uint32_t chunk_size = ReadChunkSize<uint32_t>(ifs);
-            uint32_t chunk_offset = ifs.tellg();
-            
+            BinaryReader data = index.Data(info);
+
             /* The name of the base chunk from a different file, 
             to whose bones sub-objects are attached */
-            inputs.emplace_back(ReadFixedSizeString(ifs, 
-                2 * W3D_MAX_STRING_LENGTH));
+            AddInput(data.ReadFixedSizeString(2 * W3D_MAX_STRING_LENGTH));
             
-            uint32_t n_inputs = ReadPrimitive<uint32_t>(ifs);
+            uint32_t n_inputs = data.Read<uint32_t>();
+
+            // Each sub-object takes two names, the count must agree
+            if (n_inputs > (data.Size() - data.Tell()) / (4 * W3D_MAX_STRING_LENGTH))
+            {
+                throw invalid_file_format("Aggregate info is corrupted");
+            }
 
             inputs.reserve(inputs.size() + n_inputs);
 
             for (uint32_t i = 0; i < n_inputs; ++i)
             {
                 // The name of a sub-object
-                inputs.emplace_back(ReadFixedSizeString(ifs, 
-                    2 * W3D_MAX_STRING_LENGTH));
+                AddInput(data.ReadFixedSizeString(2 * W3D_MAX_STRING_LENGTH));
                 
                 // The name of the attachment bone is skipped...
-                ifs.seekg(2 * W3D_MAX_STRING_LENGTH);
+                data.Skip(2 * W3D_MAX_STRING_LENGTH);
             }
-
-            // Skipping whatever else is there
-            ifs.seekg(chunk_offset + chunk_size);
         });
-    
-    // Skipping whatever else is there
-    ifs.seekg(offset + size);
 }
 
-void Asset::Chunk::ReadHLoD(std::ifstream& ifs)
+void Asset::Chunk::ReadHLoD(const ChunkIndex& index, uint32_t i)
 {
-    using namespace std::string_literals;
+    W3dHLodHeader header = ReadHeader<W3dHLodHeader>(index, i, 
+        ChunkType::W3D_CHUNK_HLOD_HEADER, 0x00'01'00'00);
 
-    /* Gross size accounting for 4 + 4 bytes used for 
-    the type and the size */
-    size = ReadChunkSize<uint32_t>(ifs) + 0x08;
+    name = FieldString(header.name);
+    std::string_view hier_name = FieldString(header.hierarchy_name);
+    
+    if (hier_name.size())
+    {
+        FixedName<W3D_MAX_STRING_LENGTH + 2> input("H*");
+        input += hier_name;
+        AddInput(input);
+    }
 
-    ReadHeader(ifs, ChunkType::W3D_CHUNK_HLOD_HEADER, 
-        0x28, 0x00'01'00'00, 
-        [this, &ifs]()
+    index.ForEachChild(i, ChunkType::W3D_CHUNK_HLOD_LOD_ARRAY, 
+        [this, &index](uint32_t lod_array)
         {
-            ifs.seekg(0x04, std::ios::cur); // skipping attributes
+            ReadHLoDSubObjects(index, lod_array);
+        });
+}
 
-            name = ReadFixedSizeString(ifs, W3D_MAX_STRING_LENGTH);
-            std::string hier_name = 
-                ReadFixedSizeString(ifs, W3D_MAX_STRING_LENGTH);
-            
-            if (hier_name.size())
+void Asset::Chunk::ReadHLoDSubObjects(const ChunkIndex& index, uint32_t i)
+{
+    index.ForEachChild(i, ChunkType::W3D_CHUNK_HLOD_SUB_OBJECT, 
+        [this, &index](uint32_t sub_object)
+        {
+            if (index[sub_object].size != sizeof(W3dHLodSubObject))
             {
-                inputs.emplace_back("H*"s + 
-                    std::move(hier_name));
+                throw invalid_file_format("HLoD sub-object is corrupted");
             }
-        });
 
-    ReadFromSubChunks(ifs, offset + size, 
-        ChunkType::W3D_CHUNK_HLOD_LOD_ARRAY, 
-        [this, &ifs]()
-        {
-            Chunk::ReadHLoDSubObjects(ifs);
+            AddInput(FieldString(index.Data(sub_object).Read<W3dHLodSubObject>().name));
         });
-    
-    // Skipping whatever else is there
-    ifs.seekg(offset + size);
 }
 
-void Asset::Chunk::ReadHLoDSubObjects(std::ifstream& ifs)
+void Asset::Chunk::ReadBox(const ChunkIndex& index, uint32_t i)
 {
-    uint32_t chunk_size = ReadChunkSize<uint32_t>(ifs);
-    uint32_t chunk_offset = ifs.tellg();
+    BinaryReader data = index.Data(i);
 
-    ReadFromSubChunks(ifs, 
-        chunk_offset + chunk_size, 
-        ChunkType::W3D_CHUNK_HLOD_SUB_OBJECT, 
-        [this, &ifs]()
-        {
-            uint32_t exp_chunk_size = 0x24;
-            uint32_t chunk_size = ReadChunkSize<uint32_t>(ifs);
-            uint32_t chunk_offset = ifs.tellg();
+    data.Skip(0x04); // skipping version
+    data.Skip(0x04); // skipping attributes
 
-            if (chunk_size != exp_chunk_size)
-            {
-                throw invalid_file_format("HLoD sub-object is corrupted: ");
-            }
+    name = data.ReadFixedSizeString(2 * W3D_MAX_STRING_LENGTH);
+}
 
-            ifs.seekg(0x04, std::ios::cur); // skipping the bone index
-            
-            inputs.emplace_back(ReadFixedSizeString(ifs, 
-                2 * W3D_MAX_STRING_LENGTH));
+BinaryReader Asset::Chunk::SubChunkData(const ChunkIndex& index, 
+    uint32_t i, 
+    ChunkType sub_chunk_type, 
+    uint32_t min_size)
+{
+    // The sub-chunk is not checked beyond holding enough data
+    uint32_t sub_chunk = index.FindChild(i, sub_chunk_type);
+    if (sub_chunk == ChunkIndex::npos || 
+        index[sub_chunk].size < min_size)
+    {
+        throw invalid_file_format("Chunk header is expected");
+    }
 
-            ifs.seekg(chunk_offset + chunk_size);
-        });
+    return index.Data(sub_chunk);
 }
 
-void Asset::Chunk::ReadBox(std::ifstream& ifs)
+void Asset::Chunk::ReadMorphAnimation(const ChunkIndex& index, uint32_t i)
 {
-    size = ReadChunkSize<uint32_t>(ifs) + 0x08;
+    BinaryReader data = SubChunkData(index, i, 
+        ChunkType::W3D_CHUNK_MORPHANIM_HEADER, 
+        0x04 + 2 * W3D_MAX_STRING_LENGTH);
 
-    ifs.seekg(0x04, std::ios::cur); // skipping version
-    ifs.seekg(0x04, std::ios::cur); // skipping attributes
+    data.Skip(0x04); // skipping version
 
-    name = ReadFixedSizeString(ifs, 
-        2 * W3D_MAX_STRING_LENGTH);
+    std::string_view anim_name = data.ReadFixedSizeString(W3D_MAX_STRING_LENGTH);
+    std::string_view hier_name = data.ReadFixedSizeString(W3D_MAX_STRING_LENGTH);
 
-    ifs.seekg(offset + size);
+    // Named the same way as other animations
+    name = "A*";
+    name += hier_name;
+    name += '.';
+    name += anim_name;
 }
 
-Asset::Chunk::Chunk(Chunk&& other) noexcept
+void Asset::Chunk::ReadLoDModel(const ChunkIndex& index, uint32_t i)
 {
-    swap(other);
+    BinaryReader data = SubChunkData(index, i, 
+        ChunkType::W3D_CHUNK_LODMODEL_HEADER, 
+        0x04 + W3D_MAX_STRING_LENGTH);
+
+    data.Skip(0x04); // skipping version
+    name = data.ReadFixedSizeString(W3D_MAX_STRING_LENGTH);
+
+    // Each level of detail is a render object from elsewhere
+    index.ForEachChild(i, ChunkType::W3D_CHUNK_LOD, 
+        [this, &index](uint32_t lod)
+        {
+            AddInput(index.Data(lod).ReadFixedSizeString(2 * W3D_MAX_STRING_LENGTH));
+        });
 }
 
-Asset::Chunk::Chunk(augmented::ifstream& ifs)
+void Asset::Chunk::ReadCollection(const ChunkIndex& index, uint32_t i)
 {
-    /* No checks, since they are made when
-    the containing asset is constructed */
+    BinaryReader data = SubChunkData(index, i, 
+        ChunkType::W3D_CHUNK_COLLECTION_HEADER, 
+        0x04 + W3D_MAX_STRING_LENGTH);
 
-    using namespace std::string_view_literals;
-    
-    std::string_view ext = ifs.FilePath();
-    ext = ext.substr(ext.size() - 4);
+    data.Skip(0x04); // skipping version
+    name = data.ReadFixedSizeString(W3D_MAX_STRING_LENGTH);
 
-    if (ext == ".dat"sv) ReadInfoDat(ifs);
-    else if (ext == ".w3d"sv) ReadInfoW3D(ifs);
+    // Names of render objects are null-terminated strings
+    index.ForEachChild(i, ChunkType::W3D_CHUNK_COLLECTION_OBJ_NAME, 
+        [this, &index](uint32_t obj_name)
+        {
+            BinaryReader data = index.Data(obj_name);
+            AddInput(data.ReadFixedSizeString(data.Size()));
+        });
 }
 
-void Asset::Chunk::swap(Chunk& other)
+void Asset::Chunk::ReadLight(const ChunkIndex& index, uint32_t i)
 {
-    std::swap(name, other.name);
-    std::swap(type, other.type);
-    std::swap(offset, other.offset);
-    std::swap(size, other.size);
-
-    std::swap(inputs, other.inputs);
-    std::swap(validities, other.validities);
+    // Lights carry no name, only their parameters are required
+    SubChunkData(index, i, ChunkType::W3D_CHUNK_LIGHT_INFO, 0);
 }
 
-void Asset::Chunk::SetUpValidities()
+void Asset::Chunk::ReadNullObject(const ChunkIndex& index, uint32_t i)
 {
-    validities = std::vector<bool>(inputs.capacity(), true);
+    BinaryReader data = index.Data(i);
+
+    data.Skip(0x04); // skipping version
+    data.Skip(0x04); // skipping attributes
+    data.Skip(0x08); // skipping padding
+
+    name = data.ReadFixedSizeString(2 * W3D_MAX_STRING_LENGTH);
 }
 
-bool Asset::Chunk::IsValidInput(size_t i) const
+void Asset::Chunk::ReadDazzle(const ChunkIndex& index, uint32_t i)
 {
-    return validities[i];
+    // The name is a null-terminated string of its own
+    BinaryReader data = SubChunkData(index, i, 
+        ChunkType::W3D_CHUNK_DAZZLE_NAME, 0);
+
+    std::string_view dazzle_name = data.ReadFixedSizeString(data.Size());
+    if (dazzle_name.size() > W3D_MAX_NAME_LENGTH)
+    {
+        throw invalid_file_format("Dazzle name is too long");
+    }
+
+    name = dazzle_name;
 }
 
-void Asset::Chunk::ValidateInput(size_t i)
+void Asset::Chunk::ReadSoundObject(const ChunkIndex& index, uint32_t i)
 {
-    validities[i] = true;
+    BinaryReader data = SubChunkData(index, i, 
+        ChunkType::W3D_CHUNK_SOUNDROBJ_HEADER, 
+        0x04 + W3D_MAX_STRING_LENGTH);
+
+    data.Skip(0x04); // skipping version
+    name = data.ReadFixedSizeString(W3D_MAX_STRING_LENGTH);
 }
 
-void Asset::Chunk::InvalidateInput(size_t i)
+Asset::Chunk::Chunk(Chunk&& other) noexcept
 {
-    validities[i] = false;
+    swap(other);
 }
 
-augmented::ifstream& 
-Asset::Chunk::operator>>(augmented::ifstream& ifs)
+size_t Asset::Chunk::Hash() const
 {
-    Chunk temp(ifs);
-    swap(temp);
-    return ifs;
+    return name.empty() ? NameHash(symbols.Name(name_id)) : name.Hash();
 }
 
-augmented::ifstream& 
-operator>>(augmented::ifstream& ifs, Asset::Chunk& chunk)
+void Asset::Chunk::swap(Chunk& other)
 {
-    return chunk.operator>>(ifs);
+    std::swap(name, other.name);
+    std::swap(name_id, other.name_id);
+    std::swap(type, other.type);
+    std::swap(offset, other.offset);
+    std::swap(size, other.size);
+
+    std::swap(inputs, other.inputs);
 }
 
-std::ofstream& Asset::Chunk::operator<<(std::ofstream& ofs) const
+void Asset::Chunk::WriteInfoDat(BinaryWriter& writer, 
+    std::string_view name, 
+    ChunkType type, 
+    uint32_t offset, 
+    uint32_t size)
 {
     // Other chunks are not printed
-    std::unordered_map<ChunkType, uint32_t>::const_iterator pos;
-    pos = PRIMARY_CHUNKS_INV.find(type);
-
-    if (pos == PRIMARY_CHUNKS_INV.end()) return ofs;
+    uint32_t tag = Describe(type).tag;
+    if (!tag) return;
     
-    WriteShortString(ofs, name);
-    WritePrimitive<uint32_t>(ofs, pos->second);
-    WritePrimitive<uint32_t>(ofs, offset);
-    WritePrimitive<uint32_t>(ofs, size);
-
-    return ofs;
+    writer.WriteShortString(name);
+    writer.Write<uint32_t>(tag);
+    writer.Write<uint32_t>(offset);
+    writer.Write<uint32_t>(size);
 }
 
-std::ofstream& operator<<(std::ofstream& ofs, const Asset::Chunk& chunk)
+void Asset::ReadInfoTex(augmented::ifstream& ifs)
 {
-    return chunk.operator<<(ofs);
+    name = MakeName(ifs.FileStem(), ifs.FileExt());
+    name_hash = NameHash(name);
+    
+    /* Texture names are bounded by the file system alone, so 
+    they are only kept in the symbol table */
+    chunks.emplace_back();
+    chunks.back().name_id = symbols.Intern(name);
+    chunks.back().type = ChunkType::W3D_TEXTURE_FILE;
 }
 
-void Asset::ReadInfoDat(augmented::ifstream& ifs)
+void Asset::ReadInfoW3D(augmented::ifstream& ifs)
 {
-    // Reading the name
-    name = ReadShortString(ifs.FS());
+    name = ifs.FileStem();
+    name_hash = NameHash(name);
 
-    // Reading the file creation time
-    time = ReadPrimitive<uint64_t>(ifs.FS());
+    // W3D files are read through a mapping
+    if (!ifs.IsMapped()) ifs.Map(std::string(ifs.FilePath()));
+    
+    BinaryReader& reader = ifs.Reader();
 
-    // Reading the chunk array
+    while (!reader.AtEnd())
     {
-        uint16_t n_chunks = ReadPrimitive<uint16_t>(ifs.FS());
-        chunks.reserve(n_chunks);
-
-        for (uint16_t i = 0; i < n_chunks; ++i)
+        try
+        {
+            // Skipped chunks are dropped straight away
+            if (chunks.emplace_back().ReadInfoW3D(reader) == 
+                Chunk::ReadStatus::Skipped) chunks.pop_back();
+        }
+        catch(const invalid_file_format& e)
+        {
+            throw invalid_file_format(e.what() + name);
+        }
+        catch(const std::out_of_range& e)
+        {
+            throw invalid_file_format(e.what() + name);
+        }
+        catch(const std::length_error& e)
         {
-            chunks.emplace_back(ifs);
+            // A name longer than W3D allows
+            throw invalid_file_format(e.what() + name);
         }
     }
 }
 
-void Asset::GetFileAttrs(const std::string& file_path)
+void Asset::ReadParsed(BinaryReader& reader)
 {
-    using namespace std::chrono;
-    using namespace std::filesystem;
+    uint16_t n_chunks = reader.Read<uint16_t>();
+    chunks.reserve(n_chunks);
 
-    /* Delta between Windows' and Unix's zero times:
-    12:00:00am the 1st of January 1601 and 
-    12:00:00am the 1st of January 1970 respectfully. */
-    const static uint64_t epoch_delta = 116'444'736'000'000'000;
-    
-    path file(file_path);
-    size = file_size(file);
+    for (uint16_t i = 0; i < n_chunks; ++i)
+    {
+        Chunk& chunk = chunks.emplace_back();
 
-    time = duration_cast<nanoseconds>(clock_cast<system_clock>(last_write_time(file)).time_since_epoch()).count();
-    time /= 100; // scaling to hundreds of nanoseconds
-    time += epoch_delta; // shifting to Windows' zero time
+        // The chunk's record is in the format of .dat files
+        std::string_view chunk_name = reader.ReadShortString();
+        chunk.type = Chunk::ReadTypeDat(reader);
+        chunk.offset = reader.Read<uint32_t>();
+        chunk.size = reader.Read<uint32_t>();
+        chunk.name_id = symbols.Intern(chunk_name);
+
+        // Inputs are kept lowered already
+        uint16_t n_inputs = reader.Read<uint16_t>();
+        chunk.inputs.reserve(n_inputs);
+
+        for (uint16_t j = 0; j < n_inputs; ++j)
+        {
+            chunk.inputs.push_back(symbols.Intern(reader.ReadShortString()));
+        }
+    }
 }
 
-void Asset::ReadInfoTex(augmented::ifstream& ifs)
+std::string Asset::MakeName(std::string_view file_stem, 
+    std::string_view file_ext)
 {
     using namespace std::string_view_literals;
-    
-    name = ifs.FileStem();
+
+    std::string name{file_stem};
+    if (file_ext == ".w3d"sv) return name;
 
     /* Setting the extension to be .tga
     regardless of the actual one (such is 
     the convention) */
     {
         // Checking if the file is .jpeg
-        if (ifs.FileExt().size() == 5) name.pop_back();
-        if (ifs.FileExt() != ".png"sv) name.replace(name.size() - 3, 3, "tga");
-    }
-    
-    try
-    {
-        GetFileAttrs(ifs.FilePath());
+        if (file_ext.size() == 5) name.pop_back();
+        if (file_ext != ".png"sv) name.replace(name.size() - 3, 3, "tga");
     }
-    catch(const std::exception& e)
-    {
-        std::cerr << e.what() << name << '\n';
-    }
-    
-    chunks.emplace_back();
-    chunks.back().name = name;
-    chunks.back().type = ChunkType::W3D_TEXTURE_FILE;
-}
 
-void Asset::ReadInfoW3D(augmented::ifstream& ifs)
-{
-    name = ifs.FileStem();
-    GetFileAttrs(ifs.FilePath());
-    
-    while (ifs.FS().tellg() < size)
-    {
-        try
-        {
-            chunks.emplace_back(ifs);
-        }
-        catch(const invalid_file_format& e)
-        {
-            throw invalid_file_format(e.what() + name);
-        }
-        catch(const std::runtime_error&)
-        {}
-    }
+    return name;
 }
 
 Asset::Asset(Asset&& other) noexcept
@@ -672,18 +738,46 @@ Asset::Asset(Asset&& other) noexcept
     swap(other);
 }
 
-Asset::Asset(augmented::ifstream& ifs)
+Asset::Asset(augmented::ifstream& ifs, size_t size, uint64_t time) : 
+    size{size}, 
+    time{time}
 {
     using namespace std::string_view_literals;
 
-    if (ifs.FileExt() == ".dat"sv) ReadInfoDat(ifs);
-    else if (ifs.FileExt() == ".w3d"sv) ReadInfoW3D(ifs);
+    if (ifs.FileExt() == ".w3d"sv) ReadInfoW3D(ifs);
     else ReadInfoTex(ifs);
 }
 
+Asset::Asset(std::string_view name, size_t size, uint64_t time, 
+    BinaryReader& record) : 
+    name{name}, 
+    name_hash{NameHash(name)}, 
+    size{size}, 
+    time{time}
+{
+    ReadParsed(record);
+}
+
+uint64_t Asset::ConvertFileTime(std::filesystem::file_time_type file_time)
+{
+    using namespace std::chrono;
+
+    /* Delta between Windows' and Unix's zero times:
+    12:00:00am the 1st of January 1601 and 
+    12:00:00am the 1st of January 1970 respectfully. */
+    const static uint64_t epoch_delta = 116'444'736'000'000'000;
+
+    uint64_t time = duration_cast<nanoseconds>(clock_cast<system_clock>(file_time).time_since_epoch()).count();
+    time /= 100; // scaling to hundreds of nanoseconds
+    time += epoch_delta; // shifting to Windows' zero time
+
+    return time;
+}
+
 void Asset::swap(Asset& other)
 {
     std::swap(name, other.name);
+    std::swap(name_hash, other.name_hash);
     std::swap(time, other.time);
     std::swap(size, other.size);
     std::swap(chunks, other.chunks);
@@ -707,38 +801,26 @@ bool Asset::operator>(const Asset& other) const
         time > other.time;
 }
 
-augmented::ifstream& 
-Asset::operator>>(augmented::ifstream& ifs)
-{
-    Asset temp(ifs);
-    swap(temp);
-    return ifs;
-}
-
-augmented::ifstream& 
-operator>>(augmented::ifstream& ifs, Asset& asset)
+void Asset::WriteParsed(BinaryWriter& writer) const
 {
-    return asset.operator>>(ifs);
-}
+    uint16_t n_chunks = 0;
+    for (const Chunk& chunk : chunks)
+    {
+        n_chunks += Chunk::IsCached(chunk.type) ? 1 : 0;
+    }
 
-std::ofstream& Asset::operator<<(std::ofstream& ofs) const
-{
-    WriteShortString(ofs, name);
-    WritePrimitive<uint64_t>(ofs, time);
+    writer.Write<uint16_t>(n_chunks);
 
+    for (const Chunk& chunk : chunks)
     {
-        WritePrimitive<uint16_t>(ofs, chunks.size());
+        if (!Chunk::IsCached(chunk.type)) continue;
 
-        for (const Chunk& chunk : chunks)
+        Chunk::WriteInfoDat(writer, 
+            symbols.Name(chunk.name_id), chunk.type, chunk.offset, chunk.size);
+        writer.Write<uint16_t>((uint16_t)chunk.inputs.size());
+        for (uint32_t input : chunk.inputs)
         {
-            ofs << chunk;
+            writer.WriteShortString(symbols.Name(input));
         }
     }
-
-    return ofs;
-}
-
-std::ofstream& operator<<(std::ofstream& ofs, const Asset& asset)
-{
-    return asset.operator<<(ofs);
 }
\ No newline at end of file
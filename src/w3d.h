@@ -1,6 +1,11 @@
 #pragma once
 
 #include "augmented_fstream.h"
+#include "binary_io.h"
+#include "fixed_name.h"
+#include "w3d_headers.h"
+#include "name_hash.h"
+#include "symbol_table.h"
 #include <fstream>
 
 #include <cstdint>
@@ -8,12 +13,17 @@
 #include <string>
 #include <string_view>
 
+#include <array>
 #include <vector>
-#include <unordered_map>
+
+#include <filesystem>
 
 const static uint8_t W3D_MAX_STRING_LENGTH = 0x10;
 const static uint8_t MAX_SHORT_STRING_LENGTH = 0xff;
 
+// The longest name of a chunk, such as A*HIERARCHY.ANIMATION
+const static uint8_t W3D_MAX_NAME_LENGTH = 2 * W3D_MAX_STRING_LENGTH + 3;
+
 enum class ChunkType
 {
     W3D_CHUNK_MESH = 0x0,
@@ -172,88 +182,194 @@ enum class ChunkType
     W3D_TEXTURE_FILE = 0xF00
 };
 
+/* A flat pre-order index of a chunk and its sub-chunks, 
+built from chunk headers only. The payload of a chunk is 
+never touched unless it is a container. */
+class ChunkIndex
+{
+public:
+    struct Entry
+    {
+        uint32_t type;
+        uint32_t offset; // of the chunk header
+        uint32_t size; // of the chunk data
+        uint32_t next; // the entry right after the chunk's sub-tree
+
+        uint32_t DataOffset() const { return offset + 0x08; }
+        size_t End() const { return (size_t)DataOffset() + size; }
+    };
+
+    constexpr static uint32_t npos = (uint32_t)-1;
+
+private:
+    std::vector<Entry> entries_;
+    const char* data_ = nullptr; // of the whole file
+
+private:
+    /* Chunks of these types hold sub-chunks even if some exporters 
+    leave them without the container flag; primary types are only 
+    containers at the root */
+    static bool IsContainer(uint32_t type, bool is_root);
+
+public:
+    ChunkIndex() = default;
+    ChunkIndex(const BinaryReader& reader, size_t offset) 
+    { 
+        Build(reader, offset); 
+    }
+
+    /* Indexes the chunk starting at the offset.  Every sub-chunk
+    must fit into its container, so offsets of entries only grow
+    and the work is linear in the size of the chunk. */
+    void Build(BinaryReader reader, size_t offset);
+
+    const Entry& operator[](uint32_t i) const { return entries_[i]; }
+
+    // A reader confined to the data of the chunk
+    BinaryReader Data(uint32_t i) const
+    {
+        return { data_ + entries_[i].DataOffset(), entries_[i].size };
+    }
+    size_t Size() const { return entries_.size(); }
+
+    uint32_t FirstChild(uint32_t i) const
+    {
+        return (entries_[i].next > i + 1) ? i + 1 : npos;
+    }
+
+    // The first direct sub-chunk of the type
+    uint32_t FindChild(uint32_t i, ChunkType type) const;
+
+    // Calls fn for each direct sub-chunk of the type
+    template <typename Fn>
+    void ForEachChild(uint32_t i, ChunkType type, Fn&& fn) const
+    {
+        for (uint32_t j = i + 1; j < entries_[i].next; j = entries_[j].next)
+        {
+            if (entries_[j].type == (uint32_t)type) fn(j);
+        }
+    }
+};
+
 struct Asset
 {
     struct Chunk
     {
         friend Asset;
 
-        const static std::unordered_map<uint32_t, ChunkType> PRIMARY_CHUNKS;
-        const static std::unordered_map<ChunkType, uint32_t> PRIMARY_CHUNKS_INV;
+        using Reader = void (Chunk::*)(const ChunkIndex&, uint32_t);
+
+        // How chunks of a primary type are read and cached
+        struct Descriptor
+        {
+            uint32_t tag = 0; // the type's tag in .dat files, 0 if it has none
+            Reader read = nullptr; // nullptr for types, which are skipped
+        };
+
+    private:
+        /* Descriptors by primary chunk types, which are all multiples
+        of 0x10 below 0x1000, so that the type indexes the table */
+        const static std::array<Descriptor, 0x100> DESCRIPTORS;
+
+        static const Descriptor& Describe(ChunkType type);
+        static ChunkType TypeOfTag(uint32_t tag);
+        static uint32_t FixTag(uint32_t tag);
+
+    public:
         
         ChunkType type;
-        std::string name{};
+        /* Names are kept inline only as chunks are parsed from 
+        W3D files, and are otherwise known by their ids alone */
+        FixedName<W3D_MAX_NAME_LENGTH> name{}; // with a cached hash
+        uint32_t name_id = 0; // the name's id in the symbol table
         uint32_t offset = 0;
         uint32_t size = 0;
         
-        // Chunk's inputs (bare strings with names)
-        std::vector<std::string> inputs{};
+        // Chunk's inputs (ids of names in the symbol table)
+        std::vector<uint32_t> inputs{};
 
     private:
-        std::vector<bool> validities{};
+        /* Outcomes of reading a chunk from a W3D file.  Corrupted
+        data is still reported by exceptions, as it is rare and fails
+        the whole file, while unsupported chunks are far too common
+        for unwinding the stack over each of them. */
+        enum class ReadStatus : uint8_t
+        {
+            Read = 0,
+            Skipped // unsupported, or corrupted and not cached anyway
+        };
 
     private:
-        void ReadInfoDat(augmented::ifstream&);
-        void ReadInfoW3D(augmented::ifstream&);
+        [[nodiscard]] ReadStatus ReadInfoW3D(BinaryReader&);
+        ReadStatus SkipCorrupted(BinaryReader&);
 
-        void Skip(std::ifstream&);
-        
-        template <typename Fn>
-        void ReadHeader(std::ifstream& ifs, 
-            ChunkType exp_header_type, 
-            uint32_t exp_header_size, 
-            uint32_t exp_version, 
-            Fn&& fn, 
-            uint8_t name_offset = 0);
+        void AddInput(std::string_view input);
+
+        void Skip(BinaryReader&);
         
-        void ReadHeaderName(std::ifstream& ifs, 
+        template <typename Header>
+        static Header ReadHeader(const ChunkIndex& index, 
+            uint32_t i, 
             ChunkType exp_header_type, 
-            uint32_t exp_header_size, 
-            uint32_t exp_version,   
-            uint8_t name_offset = 0);
-        
-        template <typename Fn>
-        void ReadFromSubChunks(std::ifstream&, 
-            uint32_t read_to, 
-            ChunkType trg_type, 
-            Fn&& fn);
+            uint32_t min_version);
         
-        void ReadMesh(std::ifstream&);
-        void ReadMeshTextures(std::ifstream&);
+        void ReadMesh(const ChunkIndex&, uint32_t);
+        void ReadMeshTexture(const ChunkIndex&, uint32_t);
+
+        void ReadHierarchy(const ChunkIndex&, uint32_t);
 
-        void ReadHierarchy(std::ifstream&);
+        void ReadAnimation(const ChunkIndex&, uint32_t);
+        void ReadCompressedAnimation(const ChunkIndex&, uint32_t);
 
-        void ReadAnimation(std::ifstream&);
-        void ReadCompressedAnimation(std::ifstream&);
+        void ReadEmitter(const ChunkIndex&, uint32_t);
 
-        void ReadEmitter(std::ifstream&);
+        void ReadAggregate(const ChunkIndex&, uint32_t);
 
-        void ReadAggregate(std::ifstream&);
+        void ReadHLoD(const ChunkIndex&, uint32_t);
+        void ReadHLoDSubObjects(const ChunkIndex&, uint32_t);
 
-        void ReadHLoD(std::ifstream&);
-        void ReadHLoDSubObjects(std::ifstream&);
+        void ReadBox(const ChunkIndex&, uint32_t);
 
-        void ReadBox(std::ifstream&);
+        // Data of the first sub-chunk of the type
+        static BinaryReader SubChunkData(const ChunkIndex& index, 
+            uint32_t i, 
+            ChunkType sub_chunk_type, 
+            uint32_t min_size);
+
+        void ReadMorphAnimation(const ChunkIndex&, uint32_t);
+        void ReadLoDModel(const ChunkIndex&, uint32_t);
+        void ReadCollection(const ChunkIndex&, uint32_t);
+        void ReadLight(const ChunkIndex&, uint32_t);
+        void ReadNullObject(const ChunkIndex&, uint32_t);
+        void ReadDazzle(const ChunkIndex&, uint32_t);
+        void ReadSoundObject(const ChunkIndex&, uint32_t);
         
     public:
         Chunk() = default;
         Chunk(const Chunk&) = default;
         Chunk(Chunk&&) noexcept;
-        Chunk(augmented::ifstream&);
         ~Chunk() = default;
 
         void swap(Chunk&);
 
-        void SetUpValidities();
-        bool IsValidInput(size_t i) const;
-        void ValidateInput(size_t i);
-        void InvalidateInput(size_t i);
+        // The case-neutral hash of the chunk's name
+        size_t Hash() const;
+
+        // Whether chunks of the type have a place in .dat files
+        static bool IsCached(ChunkType type);
+
+        // Reads a chunk's tag from a record of a .dat file
+        static ChunkType ReadTypeDat(BinaryReader&);
 
-        augmented::ifstream& operator>>(augmented::ifstream&);
-        friend augmented::ifstream& operator>>(augmented::ifstream&, Chunk& chunk);
+        // Whether a tag of a .dat file is written back as it is
+        static bool IsCanonicalTag(uint32_t tag);
 
-        std::ofstream& operator<<(std::ofstream&) const;
-        friend std::ofstream& operator<<(std::ofstream&, const Chunk& chunk);
+        // Writes a chunk's record in the format of .dat files
+        static void WriteInfoDat(BinaryWriter&, 
+            std::string_view name, 
+            ChunkType type, 
+            uint32_t offset, 
+            uint32_t size);
     };
 
     class invalid_file_format : public std::runtime_error
@@ -262,20 +378,34 @@ struct Asset
         using std::runtime_error::runtime_error;
     };
 
+    // Names of chunks and their inputs shared by all assets
+    static SymbolTable symbols;
+
     std::string name{};
+    size_t name_hash = 0; // case-neutral hash of the name
     size_t size = 0;
     uint64_t time = 0;
     std::vector<Chunk> chunks{}; // Primary chunks making up an asset
 
 private:
-    void GetFileAttrs(const std::string& path);
-    void ReadInfoDat(augmented::ifstream&);
     void ReadInfoTex(augmented::ifstream&);
     void ReadInfoW3D(augmented::ifstream&);
+    void ReadParsed(BinaryReader&);
 
 public:
     Asset(Asset&&) noexcept;
-    Asset(augmented::ifstream&);
+    Asset(augmented::ifstream&, size_t size, uint64_t time);
+
+    // Restores a parsed asset from its record in a parse cache
+    Asset(std::string_view name, size_t size, uint64_t time, 
+        BinaryReader& record);
+
+    // Converts a file time into Windows' format used in .dat files
+    static uint64_t ConvertFileTime(std::filesystem::file_time_type);
+
+    // Derives the name of an asset from its file's stem and extension
+    static std::string MakeName(std::string_view file_stem, 
+        std::string_view file_ext);
 
     void swap(Asset&);
 
@@ -283,9 +413,7 @@ public:
     bool operator<(const Asset& other) const;
     bool operator>(const Asset& other) const;
 
-    augmented::ifstream& operator>>(augmented::ifstream& ifs);
-    friend augmented::ifstream& operator>>(augmented::ifstream& ifs, Asset& asset);
-
-    std::ofstream& operator<<(std::ofstream& ofs) const;
-    friend std::ofstream& operator<<(std::ofstream& ofs, const Asset& asset);
+    /* Writes the cached chunks with their inputs, which is all 
+    a parse cache needs to restore the asset */
+    void WriteParsed(BinaryWriter& writer) const;
 };
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/* Layouts of W3D chunk headers as they are stored in files, so that
+a header is decoded with a single copy.  Runs of fields, which the
+cacher has no use for, are lumped together as opaque bytes.  Every
+field is naturally aligned, hence no packing is needed, which the
+assertions below make sure of. */
+
+// A zero-padded string in a field of a fixed size
+template <size_t N>
+std::string_view FieldString(const char (&field)[N])
+{
+    const char* end = (const char*)std::memchr(field, '\0', N);
+    return { field, end ? (size_t)(end - field) : N };
+}
+
+struct W3dMeshHeader3
+{
+    uint32_t version;
+    uint32_t attributes;
+    char mesh_name[16];
+    char container_name[16];
+    char counts_and_bounds[0x4c]; // numbers of elements, bounding volumes
+};
+
+struct W3dHierarchyHeader
+{
+    uint32_t version;
+    char name[16];
+    uint32_t n_pivots;
+    float center[3];
+};
+
+struct W3dAnimHeader
+{
+    uint32_t version;
+    char name[16];
+    char hierarchy_name[16];
+    uint32_t n_frames;
+    uint32_t frame_rate;
+};
+
+struct W3dCompressedAnimHeader
+{
+    uint32_t version;
+    char name[16];
+    char hierarchy_name[16];
+    uint32_t n_frames;
+    uint16_t frame_rate;
+    uint16_t flavor;
+};
+
+struct W3dEmitterHeader
+{
+    uint32_t version;
+    char name[16];
+};
+
+struct W3dAggregateHeader
+{
+    uint32_t version;
+    char name[16];
+};
+
+struct W3dHLodHeader
+{
+    uint32_t version;
+    uint32_t n_lods;
+    char name[16];
+    char hierarchy_name[16];
+};
+
+struct W3dHLodSubObject
+{
+    uint32_t bone_index;
+    char name[32];
+};
+
+static_assert(sizeof(W3dMeshHeader3) == 0x74);
+static_assert(offsetof(W3dMeshHeader3, mesh_name) == 0x08);
+static_assert(offsetof(W3dMeshHeader3, container_name) == 0x18);
+
+static_assert(sizeof(W3dHierarchyHeader) == 0x24);
+static_assert(offsetof(W3dHierarchyHeader, name) == 0x04);
+
+static_assert(sizeof(W3dAnimHeader) == 0x2c);
+static_assert(offsetof(W3dAnimHeader, name) == 0x04);
+static_assert(offsetof(W3dAnimHeader, hierarchy_name) == 0x14);
+
+static_assert(sizeof(W3dCompressedAnimHeader) == 0x2c);
+static_assert(offsetof(W3dCompressedAnimHeader, name) == 0x04);
+static_assert(offsetof(W3dCompressedAnimHeader, hierarchy_name) == 0x14);
+
+static_assert(sizeof(W3dEmitterHeader) == 0x14);
+static_assert(offsetof(W3dEmitterHeader, name) == 0x04);
+
+static_assert(sizeof(W3dAggregateHeader) == 0x14);
+static_assert(offsetof(W3dAggregateHeader, name) == 0x04);
+
+static_assert(sizeof(W3dHLodHeader) == 0x28);
+static_assert(offsetof(W3dHLodHeader, name) == 0x08);
+static_assert(offsetof(W3dHLodHeader, hierarchy_name) == 0x18);
+
+static_assert(sizeof(W3dHLodSubObject) == 0x24);
+static_assert(offsetof(W3dHLodSubObject, name) == 0x04);
\ No newline at end of file